@@ -0,0 +1,71 @@
+#include "BlockCache.hpp"
+#include "CPU.hpp"
+#include "Instruction.hpp"
+
+using namespace SPIMDF;
+
+bool BlockCache::Validate(const CPU& cpu) {
+    if (cpu.GetCodeGeneration() == generation)
+        return false;
+
+    Flush();
+    generation = cpu.GetCodeGeneration();
+    return true;
+}
+
+Block& BlockCache::Translate(const CPU& cpu, uint32_t addr, const void* const* handlers) {
+    auto block = std::make_unique<Block>();
+    block->id = nextId++;
+    block->start = addr;
+
+    for (uint32_t pc = addr; ; pc += 4) {
+        if (block->length == Block::MaxLength) {
+            block->fallthrough = pc;
+            block->ops.push_back(Block::Op{ handlers[Block::EndOfBlock] });
+            break;
+        }
+
+        const Instruction& instr = cpu.FetchInstr(pc);
+        Block::Op op{ handlers[static_cast<std::size_t>(instr.opcode)], instr.opcode };
+
+        switch (ISA::FormatOf(instr.opcode)) {
+            case ISA::Format::R: {
+                const auto& format = instr.GetFormat<ISA::RType>();
+                op.a = format.rd;
+                op.b = format.rs;
+                op.c = format.rt;
+                op.imm = format.sa;
+                break;
+            }
+            case ISA::Format::I: {
+                const auto& format = instr.GetFormat<ISA::IType>();
+                op.a = format.rt;
+                op.b = format.rs;
+                op.imm = format.imm;
+                break;
+            }
+            case ISA::Format::J:
+                break;
+        }
+
+        block->ops.push_back(op);
+        block->length++;
+
+        if (!instr.IsJump() && instr.opcode != ISA::Opcode::BRK)
+            continue;
+
+        // Resolve static targets the same way the executors do, with PC already past the branch
+        block->fallthrough = pc + 4;
+
+        if (instr.opcode == ISA::Opcode::J)
+            block->target = (block->fallthrough & 0xF0000000) | (instr.GetFormat<ISA::JType>().index << 2);
+        else if (instr.opcode != ISA::Opcode::JR && instr.opcode != ISA::Opcode::BRK)
+            block->target = block->fallthrough + instr.GetFormat<ISA::IType>().imm * 4;
+
+        break;
+    }
+
+    Block& result = *block;
+    blocks.emplace(addr, std::move(block));
+    return result;
+}
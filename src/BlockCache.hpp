@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ISA.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace SPIMDF {
+    class CPU;
+
+    // A straight-line run of the program, pre-decoded for the functional engine's threaded interpreter.
+    // A block ends after the first jump or BREAK, or after MaxLength instructions.
+    struct Block {
+        static constexpr std::size_t MaxLength = 64;
+
+        // Handler index that ends a block that was cut at MaxLength; it continues at fallthrough
+        static constexpr std::size_t EndOfBlock = ISA::NumOpcodes;
+        static constexpr std::size_t NumHandlers = ISA::NumOpcodes + 1;
+
+        // One instruction, with its operands already pulled out of the format:
+        //   R format: a = rd, b = rs, c = rt, imm = sa
+        //   I format: a = rt, b = rs, imm = sign-extended immediate
+        //   J format: unused (the target is in Block::target)
+        struct Op {
+            const void* handler; // Label in the interpreter loop
+            ISA::Opcode opcode = ISA::Opcode::NOP; // NOP for EndOfBlock
+            uint8_t a = 0;
+            uint8_t b = 0;
+            uint8_t c = 0;
+            int32_t imm = 0;
+        };
+
+        uint32_t id = 0;          // Translation order, never reused
+        uint32_t start = 0;
+        uint32_t fallthrough = 0; // Address after the last instruction
+        uint32_t target = 0;      // Taken target of a final J, BEQ, BLTZ or BGTZ
+        uint32_t length = 0;      // Instructions, i.e. ops not counting an EndOfBlock
+        std::vector<Op> ops;
+
+        // Successors, linked on first use so that hot paths go from block to block without a lookup
+        Block* takenBlock = nullptr;
+        Block* fallthroughBlock = nullptr;
+
+        // Last target of a final JR and its block
+        uint32_t indirectTarget = 0;
+        Block* indirectBlock = nullptr;
+
+        // Native translation (see JitCompiler). Runs the whole block on the register file and returns the next PC.
+        using NativeCode = uint32_t (*)(int32_t* regs, CPU* cpu);
+
+        NativeCode native = nullptr;
+        uint32_t heat = 0; // Interpreted runs, counted while the JIT is on
+    };
+
+    // Translated blocks by start address. Translations are dropped as a whole when the CPU's program changes.
+    class BlockCache {
+        std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks;
+        uint64_t generation = 0;
+        uint32_t nextId = 0;
+
+        Block& Translate(const CPU& cpu, uint32_t addr, const void* const* handlers);
+
+        public:
+        // Drops every block, and with them every chain link, if the program has changed since they were translated.
+        // Returns true if it did.
+        bool Validate(const CPU& cpu);
+
+        // Returns the block starting at addr, translating it if needed. handlers are the interpreter's labels,
+        // indexed by opcode then EndOfBlock. Blocks never move, so the reference stays valid until a flush.
+        Block& Get(const CPU& cpu, uint32_t addr, const void* const* handlers) {
+            if (auto it = blocks.find(addr); it != blocks.end())
+                return *it->second;
+
+            return Translate(cpu, addr, handlers);
+        }
+
+        void Flush() { blocks.clear(); };
+        std::size_t Size() const { return blocks.size(); };
+
+        // One more than the highest block id handed out so far
+        uint32_t IdLimit() const { return nextId; };
+    };
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Instruction.hpp"
-#include "opt_array.hpp"
+#include "PipelineConfig.hpp"
+#include "ring_buffer.hpp"
+#include <array>
+#include <cstdint>
 #include <sstream>
 
 namespace SPIMDF {
@@ -36,36 +39,118 @@ namespace SPIMDF {
 
     template<typename Entry_t, int N>
     struct Buffer {
-        opt_array<Entry_t, N> entries;
+        ring_buffer<Entry_t, N> entries;
 
         std::string ToPrintingString() const {
             std::stringstream ss;
             
             if constexpr (N > 1) {
-                std::size_t i = 0;
-                for (const auto& entry : entries) {
-                    ss << '\t' << "Entry " << i++ << ":";
+                for (std::size_t i = 0; i < entries.capacity(); i++) {
+                    ss << '\t' << "Entry " << i << ":";
 
-                    if (entry.has_value())
-                        ss << " [" << entry.value().instruction.ToString() << "]";
+                    if (i < entries.size())
+                        ss << " [" << entries[i].instruction.ToString() << "]";
 
                     ss << '\n';
                 }
             } else {
-                if (entries[0].has_value())
-                    ss << " [" << entries[0].value().instruction.ToString() << "]";
+                if (!entries.is_empty())
+                    ss << " [" << entries[0].instruction.ToString() << "]";
             }
 
             return ss.str();
         }
     };
 
-    using PreIssueQueue  = Buffer<BufferEntry::PreIssue, 4>;
+    // The pre-issue queue also keeps, for every entry, which older entries it has to wait for.
+    // Rows are updated as entries come and go, so selecting issuable entries never rescans the queue.
+    // Entries must be added and removed through Push() and Pull() to keep the rows in sync.
+    template<int N>
+    struct PreIssueBuffer : Buffer<BufferEntry::PreIssue, N> {
+        using Mask_t = uint64_t;
+        static_assert(N <= 64, "One bit per entry");
+
+        private:
+        // Bit j of depMatrix[i] is set if entry i has a RAW, WAW or WAR hazard with older entry j
+        std::array<Mask_t, N> depMatrix{};
+        Mask_t storeMask = 0;
+
+        static constexpr Mask_t Below(std::size_t i) {
+            return (Mask_t{ 1 } << i) - 1;
+        }
+
+        static bool HasRegisterHazard(const Instruction& older, const Instruction& younger) {
+            return ((younger.ReadMask() & older.WriteMask())
+                  | (younger.WriteMask() & older.ReadMask())
+                  | (younger.WriteMask() & older.WriteMask())) != 0;
+        }
+
+        public:
+        // Returns false if the queue is full
+        bool Push(const Instruction& instr) {
+            auto& entries = this->entries;
+            const std::size_t pos = entries.size();
+
+            if (!entries.push_back(BufferEntry::PreIssue{ instr }))
+                return false;
+
+            Mask_t row = 0;
+
+            for (std::size_t j = 0; j < pos; j++) {
+                if (HasRegisterHazard(entries[j].instruction, instr))
+                    row |= Mask_t{ 1 } << j;
+            }
+
+            depMatrix[pos] = row;
+
+            if (instr.IsStore())
+                storeMask |= Mask_t{ 1 } << pos;
+
+            return true;
+        }
+
+        // Removes the entry at pos, keeping the order of the rest
+        BufferEntry::PreIssue Pull(std::size_t pos) {
+            auto& entries = this->entries;
+            const std::size_t count = entries.size();
+
+            // Drop column pos from every row, and row pos from the matrix
+            const auto removeBit = [&](Mask_t m) {
+                return (m & Below(pos)) | ((m >> 1) & ~Below(pos));
+            };
+
+            for (std::size_t i = pos; i + 1 < count; i++)
+                depMatrix[i] = depMatrix[i + 1];
+
+            depMatrix[count - 1] = 0;
+
+            for (std::size_t i = pos; i + 1 < count; i++)
+                depMatrix[i] = removeBit(depMatrix[i]);
+
+            storeMask = removeBit(storeMask);
+
+            return entries.pull(pos);
+        }
+
+        // Older entries that must issue before the entry at pos can: register hazards, plus every
+        // older store if pos is a memory access (loads wait for stores, and stores stay in order)
+        Mask_t Blockers(std::size_t pos) const {
+            Mask_t blockers = depMatrix[pos];
+
+            if (this->entries[pos].instruction.IsMemAccess())
+                blockers |= storeMask & Below(pos);
+
+            return blockers;
+        }
+    };
+
+    // Depths of the first three are set at run time from PipelineConfig
+    using PreIssueQueue  = PreIssueBuffer<PipelineConfig::MaxPreIssueDepth>;
  
-    using PreALUQueue    = Buffer<BufferEntry::PreALU, 2>;
+    using PreALUQueue    = Buffer<BufferEntry::PreALU, PipelineConfig::MaxPreALUDepth>;
     using PostALUQueue   = Buffer<BufferEntry::PostALU, 1>;
 
-    using PreMemALUQueue = Buffer<BufferEntry::PreMemALU, 2>;
+    using PreMemALUQueue = Buffer<BufferEntry::PreMemALU, PipelineConfig::MaxPreMemALUDepth>;
     using PreMemQueue    = Buffer<BufferEntry::PreMem, 1>;
     using PostMemQueue   = Buffer<BufferEntry::PostMem, 1>;
 }
\ No newline at end of file
@@ -2,31 +2,57 @@
 
 #include "Instruction.hpp"
 #include "Buffer.hpp"
+#include "Disassembler.hpp"
 #include "Execs.hpp"
+#include "PipelineConfig.hpp"
+#include "Scoreboard.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
 #include <map>
+#include <stdexcept>
+#include <vector>
 
 namespace SPIMDF {
-    enum class Hazard {
-          RAW
-        , WAW
-        , WAR
+    // What a program can observe: enough to restart it on an empty pipeline at an instruction boundary
+    struct ArchState {
+        uint32_t pc = 0;
+        std::array<int32_t, 32> registers{};
+        std::map<uint32_t, int32_t> memory;
     };
 
     class CPU {
+        friend std::string Snapshot::Serialize(const CPU& cpu);
+        friend CPU Snapshot::Deserialize(std::string_view bytes);
+
         struct Register_t {
             int32_t value = 0;
-            bool pendingRead = false;
-            bool pendingWrite = false;
         };
 
-        std::map<uint32_t, Instruction> program;
+        mutable std::map<uint32_t, Instruction> program; // Mutable so lazily decoded instructions can be cached
         std::map<uint32_t, int32_t> memory;
         std::array<Register_t, 32> registers;
+        static_assert(sizeof(Register_t) == sizeof(int32_t)); // Compiled blocks address registers as an int32_t array
+        Scoreboard scoreboard;
+
+        // Undecoded text segment. Words are decoded into program the first time they are fetched.
+        uint32_t rawTextBase = 0;
+        std::vector<uint32_t> rawText;
+
+        uint64_t codeGeneration = 0; // Bumped whenever the program may have changed
+        std::vector<uint32_t>* storeLog = nullptr; // See SetStoreLog()
 
         uint64_t cycle = 1;
+        uint64_t stageCalls = 0; // Consume()/Produce() calls the stage order asked for
+        uint64_t stageSkips = 0; // ... and how many of those were skipped because the stage had no work
+        uint64_t skippedCycles = 0; // Quiescent cycles jumped over by SkipTo()
         uint32_t pc;
 
         public:
+        const PipelineConfig config;
+
         // Queues
         struct {
             PreIssueQueue preIssue;
@@ -37,8 +63,8 @@ namespace SPIMDF {
             PostMemQueue postMem;
         } queues;
 
-        // Executors
-        struct {
+        // Stages
+        struct Stages {
             FetchExec fetch;
             IssueExec issue;
             ALUExec alu;
@@ -47,55 +73,177 @@ namespace SPIMDF {
             WritebackExec writeback;
         } executors;
 
-        CPU(uint32_t pc = 0)
+        CPU(uint32_t pc = 0, const PipelineConfig& config = PipelineConfig())
         : pc(pc)
-        , executors({
-              FetchExec(*this)
-            , IssueExec(*this)
-            , ALUExec(*this)
-            , MemALUExec(*this)
-            , MemExec(*this) 
-            , WritebackExec(*this)
-        })
-        { };
-
-        Instruction& Instr(uint32_t addr) { return program[addr]; };
-        const Instruction& Instr(uint32_t addr) const { return program.at(addr); };
+        , config(config)
+        {
+            config.Validate();
+            ApplyQueueDepths();
+        };
+
+        // Returns the instruction at addr, decoding it from the raw text segment if needed. nullptr if there is none.
+        const Instruction* FindInstr(uint32_t addr) const {
+            if (auto it = program.find(addr); it != program.end())
+                return &it->second;
+
+            const uint32_t offset = addr - rawTextBase;
+
+            if (offset % 4 != 0 || offset / 4 >= rawText.size())
+                return nullptr;
+
+            return &program.emplace(addr, DecodeMachineCode(rawText[offset / 4])).first->second;
+        }
+
+        // For editing the program. Inserts a NOP if there is no instruction at addr.
+        Instruction& Instr(uint32_t addr) {
+            codeGeneration++;
+            FindInstr(addr); // Decode from the raw text first so the edit applies to the real instruction
+
+            return program[addr];
+        };
+
+        const Instruction& Instr(uint32_t addr) const {
+            if (const Instruction* instr = FindInstr(addr))
+                return *instr;
+
+            throw std::out_of_range("No instruction at address " + std::to_string(addr));
+        };
 
         Instruction& CurInstr() { return Instr(pc); };
         const Instruction& CurInstr() const { return Instr(pc); };
 
+        // The instruction at addr as fetch sees it: a NOP where there is none. Never changes the program.
+        const Instruction& FetchInstr(uint32_t addr) const {
+            static constexpr Instruction nop;
+
+            if (const Instruction* instr = FindInstr(addr))
+                return *instr;
+
+            return nop;
+        }
+
+        // Changes whenever the program is edited or reloaded, so translations of it can be checked for staleness
+        uint64_t GetCodeGeneration() const { return codeGeneration; };
+
         int32_t& Mem(uint32_t addr) { return memory[addr]; };
+
+        // What SW does, in the pipeline and in FunctionalEngine: writes a word and logs its address
+        void Store(uint32_t addr, int32_t value) {
+            memory[addr] = value;
+
+            if (storeLog != nullptr)
+                storeLog->push_back(addr);
+        }
+
+        // While set, Store() appends every address it writes to log, repeats included. Copies of the CPU
+        // share the pointer, so clear it before log goes away.
+        void SetStoreLog(std::vector<uint32_t>* log) { storeLog = log; };
+
+        // Segment loaders. Cheaper than Instr()/Mem() when addresses arrive in increasing order.
+        void LoadInstr(uint32_t addr, const Instruction& instr) {
+            codeGeneration++;
+            program.insert_or_assign(program.end(), addr, instr);
+        };
+
+        void LoadMem(uint32_t addr, int32_t datum) { memory.insert_or_assign(memory.end(), addr, datum); };
+
+        // Records an undecoded text segment starting at base. Decoded instructions already in program take priority.
+        void LoadRawText(uint32_t base, std::vector<uint32_t>&& words) {
+            codeGeneration++;
+            rawTextBase = base;
+            rawText = std::move(words);
+        }
         const auto& GetAllMem() const { return memory; };
 
         int32_t& Reg(uint8_t regAddr) { return registers[regAddr].value; };
         const int32_t& Reg(uint8_t regAddr) const { return registers[regAddr].value; };
 
-        bool IsRegPendingRead(uint8_t regAddr) const { return registers[regAddr].pendingRead; };
-        bool IsRegPendingWrite(uint8_t regAddr) const { return registers[regAddr].pendingWrite; };
-        void SetRegPendingRead(uint8_t regAddr, bool flag) { registers[regAddr].pendingRead = flag; };
-        void SetRegPendingWrite(uint8_t regAddr, bool flag) { registers[regAddr].pendingWrite = flag; };
+        bool IsRegPendingRead(uint8_t regAddr) const { return scoreboard.IsPendingRead(regAddr); };
+        bool IsRegPendingWrite(uint8_t regAddr) const { return scoreboard.IsPendingWrite(regAddr); };
+
+        Scoreboard& GetScoreboard() { return scoreboard; };
+        const Scoreboard& GetScoreboard() const { return scoreboard; };
 
         uint32_t GetPC() const { return pc; };
         uint64_t GetCycle() const { return cycle; };
+        uint64_t GetStageCalls() const { return stageCalls; };
+        uint64_t GetStageSkips() const { return stageSkips; };
+
+        static constexpr uint64_t Never = UINT64_MAX;
+
+        // Runs one cycle with the default stage order
+        void Clock();
+
+        // The first cycle, at or after the current one, in which any state can change. Cycles before it are
+        // quiescent: clocking them would only advance the cycle count. Never means the pipeline is deadlocked.
+        uint64_t NextEventCycle() const;
+
+        // Jumps over quiescent cycles up to (not including) target, which must not be after NextEventCycle()
+        void SkipTo(uint64_t target) {
+            if (target > cycle) {
+                skippedCycles += target - cycle;
+                cycle = target;
+            }
+        }
+
+        uint64_t GetSkippedCycles() const { return skippedCycles; };
+
+        // True if no stage has anything left to do, ignoring fetching new instructions
+        bool IsPipelineEmpty() const;
+
+        // Stops fetching and clocks until every fetched instruction has finished. Returns the number of cycles
+        // taken. Afterwards registers, memory and PC are the architectural state at an instruction boundary,
+        // so another engine (see FunctionalEngine) can continue from them.
+        uint64_t Drain();
+
+        // Drains this CPU, then returns a copy of it built with another pipeline geometry, which is otherwise
+        // fixed once a CPU is built. Program, registers, memory, PC and the cycle and fetch counts carry over.
+        // Throws std::invalid_argument if the config is out of range.
+        CPU Reconfigured(const PipelineConfig& newConfig);
+
+        // Empties every queue, stage slot and register lock; registers, memory, PC and the cycle count are kept.
+        // Instructions in flight are lost, so call Drain() first unless the state came from another engine.
+        void ResetPipeline() {
+            queues = decltype(queues)();
+            executors = Stages();
+            scoreboard.Clear();
+            ApplyQueueDepths();
+        }
 
+        ArchState GetArchState() const {
+            ArchState state{ pc, {}, memory };
+
+            for (std::size_t i = 0; i < registers.size(); i++)
+                state.registers[i] = registers[i].value;
+
+            return state;
+        }
+
+        // Also empties the pipeline, as anything in flight belonged to the old state
+        void SetArchState(const ArchState& state) {
+            memory = state.memory;
+            SetRegisterState(state.pc, state.registers);
+        }
+
+        // SetArchState() without the memory, for callers that bring memory up to date themselves
+        void SetRegisterState(uint32_t newPC, const std::array<int32_t, 32>& values) {
+            pc = newPC;
+
+            for (std::size_t i = 0; i < registers.size(); i++)
+                registers[i].value = values[i];
+
+            ResetPipeline();
+        }
+
+        // Runs one cycle with another compile-time stage order (see PipelineOrder)
+        template<typename Order>
         void Clock() {
-            executors.fetch.Consume();
-            executors.issue.Consume();
-            executors.alu.Consume();
-            executors.memALU.Consume();
-            executors.mem.Consume();
-            executors.writeback.Consume();
-
-            executors.fetch.Produce();
-            executors.issue.Produce();
-            executors.alu.Produce();
-            executors.memALU.Produce();
-            executors.mem.Produce();
-            executors.writeback.Produce();
+            const std::size_t ran = Order::Cycle(*this);
 
+            stageCalls += 2 * Order::NumStages;
+            stageSkips += 2 * (Order::NumStages - ran);
             cycle++;
-        };
+        }
 
         // Sets PC = addr
         void Jump(uint32_t addr) {
@@ -107,90 +255,44 @@ namespace SPIMDF {
             pc = pc + offset;
         }
 
-        // Called when an instruction is either issued or flushed from pipeline
-        void SetLocks(const Instruction& instr, bool flag) {
-            const auto [deps, affects] = instr.GetDeps();
-
-            for (const auto& r : deps) {
-                SetRegPendingRead(r, flag);
-            }
-
-            if (affects.has_value())
-                SetRegPendingWrite(affects.value(), flag);
-        }
-
         // Called when an instruction is issued and we have to update the locks
         void AddLocks(const Instruction& instr) {
-            SetLocks(instr, true);
+            scoreboard.Acquire(instr);
         }
 
-        // Called when an instruction is flushed and we have to update the locks
+        // Called when an instruction finishes or is flushed and we have to update the locks
         void RemoveLocks(const Instruction& instr) {
-            SetLocks(instr, false);
+            scoreboard.Release(instr);
         }
 
         template<Hazard... Args>
         bool HasActiveHazard(const Instruction& instr) const {
-            static_assert(sizeof...(Args) > 0);
-
-            const auto [deps, affects] = instr.GetDeps();
-
-            // Check RAW
-            if constexpr (((Args == Hazard::RAW) || ...)) {
-                for (const auto& r : deps) {
-                    if (IsRegPendingWrite(r))
-                        return true;
-                }
-            }
-
-            if (!affects.has_value()) return false; // Cannot have WAW or WAR if there are no affects
-                
-            // Check WAW
-            if constexpr (((Args == Hazard::WAW) || ...)) {
-                if (IsRegPendingWrite(affects.value()))
-                    return true;
-            }
-
-            // Check WAR
-            if constexpr (((Args == Hazard::WAR) || ...)) {
-                return IsRegPendingRead(affects.value());
-                    
-            }
-
-            return false;
+            return scoreboard.HasHazard<Args...>(instr);
         }
 
         template<Hazard... Args>
         static bool HasInterHazard(const Instruction& earlier, const Instruction& later) {
             static_assert(sizeof...(Args) > 0);
 
-            const auto [eDeps, eAffects] = earlier.GetDeps();
-            const auto [lDeps, lAffects] = later.GetDeps();
+            uint32_t conflicts = 0;
 
-            // Check RAW
-            if constexpr (((Args == Hazard::RAW) || ...)) {
-                for (const auto& r : lDeps) {
-                    if (r == eAffects)
-                        return true;
-                }
-            }
+            if constexpr (((Args == Hazard::RAW) || ...))
+                conflicts |= later.ReadMask() & earlier.WriteMask();
 
-            if (!lAffects.has_value()) return false; // Cannot have WAR or WAW if there is no affects
+            if constexpr (((Args == Hazard::WAR) || ...))
+                conflicts |= later.WriteMask() & earlier.ReadMask();
 
-            // Check WAR
-            if constexpr (((Args == Hazard::WAR) || ...)) {
-                for (const auto& r : eDeps) {
-                    if (r == lAffects)
-                        return true;
-                }
-            }
+            if constexpr (((Args == Hazard::WAW) || ...))
+                conflicts |= later.WriteMask() & earlier.WriteMask();
 
-            // Check WAW
-            if constexpr (((Args == Hazard::WAW) || ...)) {
-                return lAffects == eAffects;
-            }
+            return conflicts != 0;
+        }
 
-            return false;
+        private:
+        void ApplyQueueDepths() {
+            queues.preIssue.entries.set_capacity(config.preIssueDepth);
+            queues.preALU.entries.set_capacity(config.preALUDepth);
+            queues.preMemALU.entries.set_capacity(config.preMemALUDepth);
         }
 
         // static bool HasInterRAW_WAW_WAR(const Instruction& earlier, const Instruction& later) {
@@ -214,4 +316,52 @@ namespace SPIMDF {
         //     return lAffects.value() == eAffects.value();
         // }
     };
+
+    // A compile-time ordering of the CPU's stages, given as pointers to CPU::Stages members. All stages consume
+    // in this order, then all produce in this order.
+    // A stage without work just before its Consume() is skipped for the whole cycle. It is checked there, not
+    // at the start of the cycle, because an earlier stage's Consume() can give it work (issue pulling from the
+    // pre-issue queue makes room for fetch).
+    template<auto... StagePtrs>
+    struct PipelineOrder {
+        static constexpr std::size_t NumStages = sizeof...(StagePtrs);
+
+        // Returns the number of stages that ran
+        static std::size_t Cycle(CPU& cpu) {
+            std::array<bool, NumStages> active;
+            std::size_t i = 0;
+
+            const auto consume = [&](auto& stage) {
+                active[i] = stage.HasWork(cpu);
+
+                if (active[i++])
+                    stage.Consume(cpu);
+            };
+
+            (consume(cpu.executors.*StagePtrs), ...);
+
+            i = 0;
+            ((active[i++] ? (cpu.executors.*StagePtrs).Produce(cpu) : void()), ...);
+
+            std::size_t ran = 0;
+
+            for (const bool a : active)
+                ran += a;
+
+            return ran;
+        }
+
+        static uint64_t NextEvent(const CPU& cpu) {
+            return std::min({ (cpu.executors.*StagePtrs).NextEvent(cpu)... });
+        }
+    };
+
+    using DefaultPipelineOrder = PipelineOrder<
+          &CPU::Stages::fetch
+        , &CPU::Stages::issue
+        , &CPU::Stages::alu
+        , &CPU::Stages::memALU
+        , &CPU::Stages::mem
+        , &CPU::Stages::writeback
+    >;
 }
\ No newline at end of file
@@ -1,102 +1,346 @@
 #include "Disassembler.hpp"
 #include "CPU.hpp"
-#include <fstream>
 #include "Instruction.hpp"
 #include "ISA.hpp"
-#include <unordered_map>
+#include "Loader.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 using namespace SPIMDF;
 
 template<auto Factory, auto Decoder>
-Instruction DecodeHelper(const std::string& mach) {
+Instruction DecodeHelper(ISA::MachineWord mach) {
     auto format = Decoder(mach);
     return Instruction::CreateFromFormat<Factory>(format);
 }
 
-using DecodeFunc = Instruction(const std::string&);
+Instruction DecodeInvalid(ISA::MachineWord mach) {
+    throw std::invalid_argument("Invalid opcode " + std::to_string(ISA::Field::Opcode(mach.bits)));
+}
+
+using DecodeFunc = Instruction(*)(ISA::MachineWord);
+
+struct OpcodeDecoder {
+    ISA::Opcode opcode = ISA::Opcode::NOP;
+    DecodeFunc decoder = DecodeInvalid;
+};
+
+// Indexed by the top six bits of the machine word
+constexpr std::array<OpcodeDecoder, 64> opcodeDecoders = [] {
+    std::array<OpcodeDecoder, 64> table{};
 
-std::unordered_map<std::string, std::pair<ISA::Opcode, std::function<DecodeFunc>>> opcodeDecoders {
     // Category 1
-      { "010000", { ISA::Opcode::J   , DecodeHelper<ISA::J   , ISA::detail::Decode_J   > } } 
-    , { "010001", { ISA::Opcode::JR  , DecodeHelper<ISA::JR  , ISA::detail::Decode_JR  > } } 
-    , { "010010", { ISA::Opcode::BEQ , DecodeHelper<ISA::BEQ , ISA::detail::Decode_BEQ > } } 
-    , { "010011", { ISA::Opcode::BLTZ, DecodeHelper<ISA::BLTZ, ISA::detail::Decode_BLTZ> } } 
-    , { "010100", { ISA::Opcode::BGTZ, DecodeHelper<ISA::BGTZ, ISA::detail::Decode_BGTZ> } } 
-    , { "010101", { ISA::Opcode::BRK , DecodeHelper<ISA::BRK , ISA::detail::Decode_BRK > } }  
-    , { "010110", { ISA::Opcode::SW  , DecodeHelper<ISA::SW  , ISA::detail::Decode_SW  > } } 
-    , { "010111", { ISA::Opcode::LW  , DecodeHelper<ISA::LW  , ISA::detail::Decode_LW  > } } 
-    , { "011000", { ISA::Opcode::SLL , DecodeHelper<ISA::SLL , ISA::detail::Decode_SLL > } } 
-    , { "011001", { ISA::Opcode::SRL , DecodeHelper<ISA::SRL , ISA::detail::Decode_SRL > } } 
-    , { "011010", { ISA::Opcode::SRA , DecodeHelper<ISA::SRA , ISA::detail::Decode_SRA > } } 
-    , { "011011", { ISA::Opcode::NOP , DecodeHelper<ISA::NOP , ISA::detail::Decode_NOP > } } 
+    table[0b010000] = { ISA::Opcode::J   , DecodeHelper<ISA::J   , ISA::detail::Decode_J   > };
+    table[0b010001] = { ISA::Opcode::JR  , DecodeHelper<ISA::JR  , ISA::detail::Decode_JR  > };
+    table[0b010010] = { ISA::Opcode::BEQ , DecodeHelper<ISA::BEQ , ISA::detail::Decode_BEQ > };
+    table[0b010011] = { ISA::Opcode::BLTZ, DecodeHelper<ISA::BLTZ, ISA::detail::Decode_BLTZ> };
+    table[0b010100] = { ISA::Opcode::BGTZ, DecodeHelper<ISA::BGTZ, ISA::detail::Decode_BGTZ> };
+    table[0b010101] = { ISA::Opcode::BRK , DecodeHelper<ISA::BRK , ISA::detail::Decode_BRK > };
+    table[0b010110] = { ISA::Opcode::SW  , DecodeHelper<ISA::SW  , ISA::detail::Decode_SW  > };
+    table[0b010111] = { ISA::Opcode::LW  , DecodeHelper<ISA::LW  , ISA::detail::Decode_LW  > };
+    table[0b011000] = { ISA::Opcode::SLL , DecodeHelper<ISA::SLL , ISA::detail::Decode_SLL > };
+    table[0b011001] = { ISA::Opcode::SRL , DecodeHelper<ISA::SRL , ISA::detail::Decode_SRL > };
+    table[0b011010] = { ISA::Opcode::SRA , DecodeHelper<ISA::SRA , ISA::detail::Decode_SRA > };
+    table[0b011011] = { ISA::Opcode::NOP , DecodeHelper<ISA::NOP , ISA::detail::Decode_NOP > };
 
     // Category 2
-    , { "110000", { ISA::Opcode::ADD , DecodeHelper<ISA::ADD , ISA::detail::Decode_ADD > } }
-    , { "110001", { ISA::Opcode::SUB , DecodeHelper<ISA::SUB , ISA::detail::Decode_SUB > } }
-    , { "110010", { ISA::Opcode::MUL , DecodeHelper<ISA::MUL , ISA::detail::Decode_MUL > } }
-    , { "110011", { ISA::Opcode::AND , DecodeHelper<ISA::AND , ISA::detail::Decode_AND > } }
-    , { "110100", { ISA::Opcode::OR  , DecodeHelper<ISA::OR  , ISA::detail::Decode_OR  > } }
-    , { "110101", { ISA::Opcode::XOR , DecodeHelper<ISA::XOR , ISA::detail::Decode_XOR > } }
-    , { "110110", { ISA::Opcode::NOR , DecodeHelper<ISA::NOR , ISA::detail::Decode_NOR > } }
-    , { "110111", { ISA::Opcode::SLT , DecodeHelper<ISA::SLT , ISA::detail::Decode_SLT > } }
-    , { "111000", { ISA::Opcode::ADDI, DecodeHelper<ISA::ADDI, ISA::detail::Decode_ADDI> } }
-    , { "111001", { ISA::Opcode::ANDI, DecodeHelper<ISA::ANDI, ISA::detail::Decode_ANDI> } }
-    , { "111010", { ISA::Opcode::ORI , DecodeHelper<ISA::ORI , ISA::detail::Decode_ORI > } }
-    , { "111011", { ISA::Opcode::XORI, DecodeHelper<ISA::XORI, ISA::detail::Decode_XORI> } }
-};
+    table[0b110000] = { ISA::Opcode::ADD , DecodeHelper<ISA::ADD , ISA::detail::Decode_ADD > };
+    table[0b110001] = { ISA::Opcode::SUB , DecodeHelper<ISA::SUB , ISA::detail::Decode_SUB > };
+    table[0b110010] = { ISA::Opcode::MUL , DecodeHelper<ISA::MUL , ISA::detail::Decode_MUL > };
+    table[0b110011] = { ISA::Opcode::AND , DecodeHelper<ISA::AND , ISA::detail::Decode_AND > };
+    table[0b110100] = { ISA::Opcode::OR  , DecodeHelper<ISA::OR  , ISA::detail::Decode_OR  > };
+    table[0b110101] = { ISA::Opcode::XOR , DecodeHelper<ISA::XOR , ISA::detail::Decode_XOR > };
+    table[0b110110] = { ISA::Opcode::NOR , DecodeHelper<ISA::NOR , ISA::detail::Decode_NOR > };
+    table[0b110111] = { ISA::Opcode::SLT , DecodeHelper<ISA::SLT , ISA::detail::Decode_SLT > };
+    table[0b111000] = { ISA::Opcode::ADDI, DecodeHelper<ISA::ADDI, ISA::detail::Decode_ADDI> };
+    table[0b111001] = { ISA::Opcode::ANDI, DecodeHelper<ISA::ANDI, ISA::detail::Decode_ANDI> };
+    table[0b111010] = { ISA::Opcode::ORI , DecodeHelper<ISA::ORI , ISA::detail::Decode_ORI > };
+    table[0b111011] = { ISA::Opcode::XORI, DecodeHelper<ISA::XORI, ISA::detail::Decode_XORI> };
+
+    return table;
+}();
+
+Instruction SPIMDF::DecodeMachineCode(uint32_t mach) {
+    return opcodeDecoders[ISA::Field::Opcode(mach)].decoder(ISA::MachineWord{ mach });
+}
+
+// Packs a string of ASCII '0'/'1' characters into a machine word
+uint32_t SPIMDF::PackMachineCode(const std::string& mach) {
+    if (mach.size() == 32)
+        return PackMachineWord(mach.data());
 
-Instruction DecodeMachineCode(const std::string& mach) {
-    std::string binOpcode = mach.substr(0, 6);
+    uint32_t word = 0;
 
-    const auto& [opcode, decoder] = opcodeDecoders[binOpcode];
+    for (char c : mach)
+        word = (word << 1) | static_cast<uint32_t>(c == '1');
 
-    return decoder(mach);
+    return word;
 }
 
-int32_t DecodeProgramDatum(const std::string& mach) {
-    return FromTwosComp(mach);
+int32_t DecodeProgramDatum(uint32_t mach) {
+    return static_cast<int32_t>(mach);
 }
 
-void SPIMDF::Disassemble(const char* filename, CPU& cpu) {
-    std::ifstream file(filename);
-    std::ofstream output("disassembly.txt", std::ios::binary);
-    char buffer[200];
+// Listing lines are "<32 bits>\t<address>\t<assembly or datum>\n"
+constexpr std::size_t MaxListingLine = 32 + 1 + 10 + 1 + Printers::MaxLength + 1;
+
+char* FormatListingPrefix(char* out, const char* machCode, uint32_t addr) {
+    out = std::copy_n(machCode, 32, out);
+    *out++ = '\t';
+    out = std::to_chars(out, out + 10, addr).ptr;
+    *out++ = '\t';
+    return out;
+}
+
+char* FormatListingLine(char* out, const char* machCode, uint32_t addr, const Instruction& instr) {
+    out = instr.Format(FormatListingPrefix(out, machCode, addr));
+    *out++ = '\n';
+    return out;
+}
+
+char* FormatListingLine(char* out, const char* machCode, uint32_t addr, int32_t datum) {
+    out = std::to_chars(FormatListingPrefix(out, machCode, addr), out + MaxListingLine, datum).ptr;
+    *out++ = '\n';
+    return out;
+}
+
+// Writes the listing through one fixed buffer that is flushed only when full
+class ListingWriter {
+    std::FILE* file;
+    std::unique_ptr<char[]> buffer;
+    char* cur;
+    char* const end;
+
+    public:
+    explicit ListingWriter(const char* filename, std::size_t capacity = std::size_t{ 4 } << 20)
+        : file(std::fopen(filename, "wb"))
+        , buffer(new char[capacity])
+        , cur(buffer.get())
+        , end(buffer.get() + capacity)
+    { }
+
+    ~ListingWriter() {
+        Flush();
 
-    if (!file.is_open()) {
-        output << "File not found" << std::endl;
-        std::terminate();
+        if (file != nullptr)
+            std::fclose(file);
     }
 
-    std::string machCode;
+    bool IsOpen() const { return file != nullptr; }
+
+    // Returns space for at least one listing line
+    char* Reserve() {
+        if (static_cast<std::size_t>(end - cur) < MaxListingLine)
+            Flush();
+
+        return cur;
+    }
+
+    void Commit(char* newCur) { cur = newCur; }
+
+    void Write(std::string_view text) {
+        Flush();
+        std::fwrite(text.data(), 1, text.size(), file);
+    }
+
+    void Flush() {
+        if (file != nullptr)
+            std::fwrite(buffer.get(), 1, cur - buffer.get(), file);
+
+        cur = buffer.get();
+    }
+};
+
+[[noreturn]] void FileNotFound(ListingWriter* listing) {
+    if (listing != nullptr && listing->IsOpen())
+        listing->Write("File not found\n");
+    else
+        fprintf(stderr, "File not found\n");
+
+    std::terminate();
+}
+
+void SPIMDF::Disassemble(const char* filename, CPU& cpu, const char* listingFilename) {
+    MappedFile file(filename);
+    std::optional<ListingWriter> listing;
+
+    if (listingFilename != nullptr)
+        listing.emplace(listingFilename);
+
+    if (!file.IsOpen())
+        FileNotFound(listing ? &*listing : nullptr);
+
     uint32_t curAddr = 256;
+    bool inText = true; // Everything after the first BRK is data
+
+    ForEachMachineWord(file.View(), [&](uint32_t mach, std::string_view machCode) {
+        if (inText) {
+            Instruction instr = DecodeMachineCode(mach);
+
+            cpu.LoadInstr(curAddr, instr);
 
-    while (file >> machCode) {
-        std::string category = machCode.substr(0, 2);
+            if (listing)
+                listing->Commit(FormatListingLine(listing->Reserve(), machCode.data(), curAddr, instr));
 
-        Instruction instr = DecodeMachineCode(machCode);
+            inText = instr.opcode != ISA::Opcode::BRK;
+        } else {
+            int32_t datum = DecodeProgramDatum(mach);
 
-        cpu.Instr(curAddr) = instr;
-       
-        sprintf(buffer, "%s\t%u\t%s\n", machCode.c_str(), curAddr, instr.ToString().c_str());
-        output << buffer;
+            cpu.LoadMem(curAddr, datum);
+
+            if (listing)
+                listing->Commit(FormatListingLine(listing->Reserve(), machCode.data(), curAddr, datum));
+        }
 
         curAddr += 4;
-        
-        if (instr.opcode == ISA::Opcode::BRK)
-            break;
+        return true;
+    });
+}
+
+
+void SPIMDF::DisassembleParallel(const char* filename, CPU& cpu, unsigned threads, const char* listingFilename) {
+    MappedFile file(filename);
+    std::optional<ListingWriter> listing;
+
+    if (listingFilename != nullptr)
+        listing.emplace(listingFilename);
+
+    if (!file.IsOpen())
+        FileNotFound(listing ? &*listing : nullptr);
+    const std::string_view input = file.View();
+    threads = ResolveThreads(threads);
+
+    // Split the input into pieces that start and end on whitespace, so no word straddles two pieces
+    std::vector<std::size_t> splits{ 0 };
+
+    for (unsigned i = 1; i < threads; i++) {
+        std::size_t pos = std::max(splits.back(), input.size() * i / threads);
+
+        while (pos < input.size() && !detail::IsSpace(input[pos]))
+            pos++;
+
+        splits.push_back(pos);
     }
 
-    while (file >> machCode) {
-        int32_t datum = DecodeProgramDatum(machCode);
+    splits.push_back(input.size());
 
-        cpu.Mem(curAddr) = datum;
+    // Parse each piece and find its first BRK
+    constexpr std::size_t NoBreak = std::numeric_limits<std::size_t>::max();
 
-        sprintf(buffer, "%s\t%u\t%i\n", machCode.c_str(), curAddr, datum);
-        output << buffer;
+    struct Piece {
+        std::vector<uint32_t> words;
+        std::vector<const char*> chars;
+        std::size_t firstBreak = NoBreak;
+    };
 
-        curAddr += 4;
+    std::vector<Piece> pieces(splits.size() - 1);
+
+    ParallelFor(pieces.size(), threads, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            Piece& piece = pieces[i];
+            piece.words.reserve((splits[i + 1] - splits[i]) / 33 + 1);
+            piece.chars.reserve(piece.words.capacity());
+
+            ForEachMachineWord(input.substr(splits[i], splits[i + 1] - splits[i]), [&](uint32_t mach, std::string_view chars) {
+                if (piece.firstBreak == NoBreak && ISA::Field::IsBreak(mach))
+                    piece.firstBreak = piece.words.size();
+
+                piece.words.push_back(mach);
+                piece.chars.push_back(chars.data());
+                return true;
+            });
+        }
+    });
+
+    // Concatenate the pieces. The text segment ends at the first BRK of the earliest piece that has one.
+    std::vector<uint32_t> words;
+    std::vector<const char*> chars;
+    std::size_t textCount = NoBreak;
+
+    for (Piece& piece : pieces) {
+        if (textCount == NoBreak && piece.firstBreak != NoBreak)
+            textCount = words.size() + piece.firstBreak + 1;
+
+        words.insert(words.end(), piece.words.begin(), piece.words.end());
+        chars.insert(chars.end(), piece.chars.begin(), piece.chars.end());
     }
 
-    output << std::flush;
-    output.close();
+    pieces.clear();
+    textCount = std::min(textCount, words.size());
+
+    // Decode the text segment and format the listing, each chunk into its own pre-sized buffer
+    std::vector<Instruction> text(textCount);
+    std::vector<std::string> listingChunks(listing ? threads : 0);
+
+    ParallelFor(words.size(), threads, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        char* out = nullptr;
+
+        if (listing) {
+            listingChunks[chunk].resize((end - begin) * MaxListingLine);
+            out = listingChunks[chunk].data();
+        }
+
+        for (std::size_t i = begin; i < end; i++) {
+            const uint32_t addr = static_cast<uint32_t>(256 + 4 * i);
+
+            if (i < textCount) {
+                text[i] = DecodeMachineCode(words[i]);
+
+                if (listing)
+                    out = FormatListingLine(out, chars[i], addr, text[i]);
+            } else if (listing) {
+                out = FormatListingLine(out, chars[i], addr, DecodeProgramDatum(words[i]));
+            }
+        }
+
+        if (listing)
+            listingChunks[chunk].resize(out - listingChunks[chunk].data());
+    });
+
+    // Bulk insert in address order
+    for (std::size_t i = 0; i < words.size(); i++) {
+        const uint32_t addr = static_cast<uint32_t>(256 + 4 * i);
+
+        if (i < textCount)
+            cpu.LoadInstr(addr, text[i]);
+        else
+            cpu.LoadMem(addr, DecodeProgramDatum(words[i]));
+    }
+
+    for (const std::string& part : listingChunks)
+        listing->Write(part);
+}
+
+void SPIMDF::LoadLazy(const char* filename, CPU& cpu) {
+    MappedFile file(filename);
+
+    if (!file.IsOpen())
+        FileNotFound(nullptr);
+
+    std::vector<uint32_t> text;
+    uint32_t curAddr = 256;
+    bool inText = true; // Everything after the first BRK is data
+
+    ForEachMachineWord(file.View(), [&](uint32_t mach, std::string_view) {
+        if (inText) {
+            text.push_back(mach);
+            inText = !ISA::Field::IsBreak(mach);
+        } else {
+            cpu.LoadMem(curAddr, DecodeProgramDatum(mach));
+        }
+
+        curAddr += 4;
+        return true;
+    });
+
+    cpu.LoadRawText(256, std::move(text));
 }
\ No newline at end of file
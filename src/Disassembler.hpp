@@ -1,9 +1,21 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <string>
 
 namespace SPIMDF {
     class CPU;
+    class Instruction;
 
-    void Disassemble(const char* filename, CPU& cpu);
+    Instruction DecodeMachineCode(uint32_t mach);
+    uint32_t PackMachineCode(const std::string& mach);
+
+    // Loads a textual program into the CPU. If listingFilename is given, also writes the disassembly listing there.
+    void Disassemble(const char* filename, CPU& cpu, const char* listingFilename = nullptr);
+
+    // Same result as Disassemble, but parses, decodes and formats the listing on `threads` threads (0 = all cores)
+    void DisassembleParallel(const char* filename, CPU& cpu, unsigned threads, const char* listingFilename = nullptr);
+
+    // Loads the text segment undecoded (see CPU::LoadRawText) and the data segment. Does not write a listing.
+    void LoadLazy(const char* filename, CPU& cpu);
 }
\ No newline at end of file
@@ -3,77 +3,86 @@
 #include "CPU.hpp"
 #include "ISA.hpp"
 #include "Instruction.hpp"
+#include <algorithm>
+#include <array>
 #include <tuple>
+#include <utility>
 
 using namespace SPIMDF;
 
-void FetchExec::Consume() {
+bool FetchExec::HasWork(const CPU& cpu) const {
+    return IsStalled() || IsExecuted() || (!isBroken && !cpu.queues.preIssue.entries.is_full());
+}
+
+uint64_t FetchExec::NextEvent(const CPU& cpu) const {
+    // A stalled branch only waits on registers, which only change when another stage makes progress
+    const bool canProgress = IsExecuted()
+        || (IsStalled() ? !cpu.HasActiveHazard<Hazard::RAW>(staller) && !HasStallerPreIssueHazard(cpu)
+                        : !isBroken && !cpu.queues.preIssue.entries.is_full());
+
+    return canProgress ? cpu.GetCycle() : CPU::Never;
+}
+
+void FetchExec::Consume(CPU& cpu) {
     if (IsStalled() || isBroken)
         return;
     
     // Check how many empty slots there are so we fetch the right amount
-    std::size_t numEmpty = cpu->queues.preIssue.entries.num_empty();
-
-    // Decode  for first slot
-    if (numEmpty == 0) return; // Check for empty space in preissue queue
-    if (cpu->CurInstr().opcode == ISA::Opcode::BRK) {
-        isBroken = true;
-        goto DecodedJumpOrBreak;
-    } 
-    if (cpu->CurInstr().IsJump()) // If it is a jump, we need to stall
-        goto DecodedJumpOrBreak;
-
-    // Set first slot
-    slot1 = cpu->CurInstr();
-    cpu->RelJump(4);
-
-    // Decode for second slot
-    if (numEmpty == 1) return; // Check for empty space in preissue queue
-    if (cpu->CurInstr().opcode == ISA::Opcode::BRK) {
-        isBroken = true;
-        goto DecodedJumpOrBreak;
-    } 
-    if (cpu->CurInstr().IsJump()) // If it is a jump, we need to stall
-        goto DecodedJumpOrBreak;
-
-    // Set second slot
-    slot2 = cpu->CurInstr();
-    cpu->RelJump(4);
+    const std::size_t numFetch = std::min<std::size_t>(cpu.config.fetchWidth, cpu.queues.preIssue.entries.num_empty());
+
+    for (numSlots = 0; numSlots < numFetch; numSlots++) { // Check for empty space in preissue queue
+        // Decode for next slot
+        const Instruction& instr = cpu.FetchInstr(cpu.GetPC());
+
+        if (instr.opcode == ISA::Opcode::BRK) {
+            isBroken = true;
+            goto DecodedJumpOrBreak;
+        } 
+        if (instr.IsJump()) // If it is a jump, we need to stall
+            goto DecodedJumpOrBreak;
+
+        // Set slot
+        slots[numSlots] = instr;
+        cpu.RelJump(4);
+    }
+
+    fetched += numSlots;
     return;
 
 DecodedJumpOrBreak: // Stall if we encounter a jump instruction
-    staller = cpu->CurInstr();
-    cpu->RelJump(4);
+    staller = cpu.FetchInstr(cpu.GetPC());
+    cpu.RelJump(4);
+    fetched += numSlots + 1;
     return;
 }
 
-void FetchExec::Produce() {
+void FetchExec::Produce(CPU& cpu) {
     // Don't need to check for empty space because we checked that in Consume().
-    // Using std::move will make the instruction a noop.
-    if (slot1.opcode != ISA::Opcode::NOP)
-        cpu->queues.preIssue.entries.push_back(BufferEntry::PreIssue{std::move(slot1)});
-    if (slot2.opcode != ISA::Opcode::NOP)
-        cpu->queues.preIssue.entries.push_back(BufferEntry::PreIssue{std::move(slot2)});
+    // NOPs take a fetch slot but are dropped here
+    for (std::size_t i = 0; i < numSlots; i++) {
+        if (slots[i].opcode != ISA::Opcode::NOP)
+            cpu.queues.preIssue.Push(slots[i]);
+    }
+
+    numSlots = 0;
     
     // Remove the executed instruction if it exists
     if (IsExecuted()) {
-        const auto _ = std::move(executed); // Clear previously executed instruction
+        executed = Instruction(); // Clear previously executed instruction
     }
 
     if (IsStalled()) {
         // Check if we are stalled. If we are, check reg status and possibly move to execution
-        if (!cpu->HasActiveHazard<Hazard::RAW>(staller) && !HasStallerPreIssueHazard()) {
-            staller.Execute(*cpu);
-            executed = std::move(staller);
+        if (!cpu.HasActiveHazard<Hazard::RAW>(staller) && !HasStallerPreIssueHazard(cpu)) {
+            staller.Execute(cpu);
+            executed = std::exchange(staller, Instruction());
         }
     }
 }
 
-bool FetchExec::HasStallerPreIssueHazard() const {
-    for (const auto& entry : cpu->queues.preIssue.entries) {
-        if (!entry.has_value()) break;
-        
-        if (cpu->HasInterHazard<Hazard::RAW>(entry->instruction, staller))
+bool FetchExec::HasStallerPreIssueHazard(const CPU& cpu) const {
+    for (const auto& entry : cpu.queues.preIssue.entries) {
+        if (cpu.HasInterHazard<Hazard::RAW>(entry.instruction, staller))
             return true;
     }
 
@@ -88,161 +97,233 @@ bool FetchExec::IsExecuted() const {
     return executed.opcode != ISA::Opcode::NOP;
 }
 
-void IssueExec::Consume() {
-    auto& preIssEntries = cpu->queues.preIssue.entries;
-    
-    auto instr1 = preIssEntries.end();
-    auto instr2 = preIssEntries.end();
+bool IssueExec::HasWork(const CPU& cpu) const {
+    return !cpu.queues.preIssue.entries.is_empty();
+}
 
-    for (auto it = preIssEntries.begin(); it != preIssEntries.end(); it++) {
-        auto& entry = *it;
+std::size_t IssueExec::Select(const CPU& cpu, std::array<std::size_t, PipelineConfig::MaxIssueWidth>& selected) const {
+    const auto& preIssue = cpu.queues.preIssue;
+    const std::size_t count = preIssue.entries.size();
+    const std::size_t issueWidth = cpu.config.issueWidth;
+    const std::size_t maxMem = cpu.config.IssueWidthMem();
+    const std::size_t maxALU = cpu.config.IssueWidthALU();
+    
+    std::size_t numSelected = 0;
+    std::size_t numMem = 0;
+    std::size_t numALU = 0;
 
-        if (!entry.has_value()) break;
-        
-        Instruction& potentialIssue = entry.value().instruction;
+    for (std::size_t i = 0; i < count; i++) {
+        const Instruction& potentialIssue = preIssue.entries[i].instruction;
+        const bool isMem = potentialIssue.IsMemAccess();
 
-        // Check for structural hazard with existing instructions in PreALU and PreMemALU
-        if (potentialIssue.IsMemAccess() && cpu->queues.preMemALU.entries.is_full())
+        // Check for structural hazard with existing instructions in PreALU and PreMemALU,
+        // and with the instructions of the same kind selected this cycle
+        if (isMem && (numMem == maxMem || numMem >= cpu.queues.preMemALU.entries.num_empty()))
             continue;
         
-        if (!potentialIssue.IsMemAccess() && cpu->queues.preALU.entries.is_full())
+        if (!isMem && (numALU == maxALU || numALU >= cpu.queues.preALU.entries.num_empty()))
             continue;
 
         // Check if RAW or WAW hazard exists on active instructions (anything issued but not finished)
-        if (cpu->HasActiveHazard<Hazard::RAW, Hazard::WAW>(potentialIssue))
+        if (cpu.HasActiveHazard<Hazard::RAW, Hazard::WAW>(potentialIssue))
             continue;
      
-        // Now check all previous not-issued instructions for hazards
-        for (auto pit = preIssEntries.begin(); pit != it; pit++) {
-            // Check RAW, WAW, WAR hazard
-            if (cpu->HasInterHazard<Hazard::RAW, Hazard::WAW, Hazard::WAR>(pit->value().instruction, potentialIssue))
-                goto SKIP_INSTR; // continue outer loop
-
-            // Make sure all loads only happen once previous stores have been issued (if it potentialIssue is a load)
-            // Additionally make sure any stores happen in order (if potentialIssue is a store)
-            if (potentialIssue.IsMemAccess() && pit->value().instruction.IsStore())
-                goto SKIP_INSTR; // continue outer loop
-        }
+        // Now check all previous not-issued instructions for RAW, WAW, WAR hazards and store ordering
+        if (preIssue.Blockers(i) != 0)
+            continue;
 
         // No hazard, select this instruction.
-        // But, we can't change the array because we are iterating through it
-        if (instr1 == preIssEntries.end()) {
-            instr1 = it;
-        } else if (instr2 == preIssEntries.end()) {
-            // Now we need to check if this second instruction will have a structural hazard with the first instruction selected
-            if (instr1->value().instruction.IsMemAccess() == potentialIssue.IsMemAccess()) // If they are the same type of "access", then hazard
-                continue;
-
-            instr2 = it;
-            break; // Maximum of 2 instructions.
-        }
+        // But, we can't change the queue because we are iterating through it
+        selected[numSelected++] = i;
+        (isMem ? numMem : numALU)++;
 
-        SKIP_INSTR: // For continuing outer loop from inner loop
-        ; // Noop
+        if (numSelected == issueWidth)
+            break;
     }
 
-    // Continue with the selected instructions
-    // Do second instruction first so that the iterator positions are not invalidated
-    //TODO: Check if HasInterWAW_WAR here is necessary
-    // if (instr2 != preIssEntries.end() && !CPU::HasInterHazard<Hazard::WAW, Hazard::WAR>(instr1->value().instruction, instr2->value().instruction)) {
-    if (instr2 != preIssEntries.end()) {
-        slot2 = preIssEntries.pull(instr2).instruction;
-        cpu->AddLocks(slot2); // Need to add locks here because a branch instruction will not check slots for hazards on execution
-    }
+    return numSelected;
+}
+
+uint64_t IssueExec::NextEvent(const CPU& cpu) const {
+    std::array<std::size_t, PipelineConfig::MaxIssueWidth> selected;
+
+    return HasWork(cpu) && Select(cpu, selected) != 0 ? cpu.GetCycle() : CPU::Never;
+}
+
+void IssueExec::Consume(CPU& cpu) {
+    std::array<std::size_t, PipelineConfig::MaxIssueWidth> selected; // Positions in the pre-issue queue
+    numSlots = Select(cpu, selected);
 
-    if (instr1 != preIssEntries.end()) {
-        slot1 = preIssEntries.pull(instr1).instruction;
-        cpu->AddLocks(slot1);
+    // Continue with the selected instructions
+    // Pull the youngest first so that the older positions are not invalidated
+    for (std::size_t k = numSlots; k-- > 0;) {
+        slots[k] = cpu.queues.preIssue.Pull(selected[k]).instruction;
+        cpu.AddLocks(slots[k]); // Need to add locks here because a branch instruction will not check slots for hazards on execution
     }
 }
 
-void IssueExec::Produce() {
-    if (!slot1.IsNop()) {
-        // cpu->AddLocks(slot1);
+void IssueExec::Produce(CPU& cpu) {
+    for (std::size_t k = 0; k < numSlots; k++) {
+        const Instruction& instr = slots[k];
 
-        if (slot1.IsMemAccess())
-            cpu->queues.preMemALU.entries.push_back(BufferEntry::PreMemALU{ std::move(slot1) });
+        if (instr.IsMemAccess())
+            cpu.queues.preMemALU.entries.push_back(BufferEntry::PreMemALU{ instr });
         else
-            cpu->queues.preALU.entries.push_back(BufferEntry::PreALU{ std::move(slot1) });
+            cpu.queues.preALU.entries.push_back(BufferEntry::PreALU{ instr });
+    }
 
-        if (!slot2.IsNop()) {
-            // cpu->AddLocks(slot2);
+    numSlots = 0;
+}
 
-            if (slot2.IsMemAccess())
-                cpu->queues.preMemALU.entries.push_back(BufferEntry::PreMemALU{ std::move(slot2) });
-            else
-                cpu->queues.preALU.entries.push_back(BufferEntry::PreALU{ std::move(slot2) });
-        }
-    }
-        
+bool ALUExec::HasWork(const CPU& cpu) const {
+    return !cpu.queues.preALU.entries.is_empty();
+}
+
+uint64_t ALUExec::NextEvent(const CPU& cpu) const {
+    return HasWork(cpu) ? cpu.GetCycle() : CPU::Never; // Single-cycle unit
 }
 
-void ALUExec::Consume() {
-    if (!cpu->queues.preALU.entries.is_empty())
-        slot = cpu->queues.preALU.entries.pop_front().instruction;
+void ALUExec::Consume(CPU& cpu) {
+    if (!cpu.queues.preALU.entries.is_empty())
+        slot = cpu.queues.preALU.entries.pop_front().instruction;
 }
 
-void ALUExec::Produce() {
+void ALUExec::Produce(CPU& cpu) {
     if (slot.IsNop()) return;
     
-    int32_t result = slot.ExecuteResult(*cpu);
-    cpu->queues.postALU.entries.push_back(BufferEntry::PostALU{ std::move(slot), result });
+    int32_t result = slot.ExecuteResult(cpu);
+    cpu.queues.postALU.entries.push_back(BufferEntry::PostALU{ std::exchange(slot, Instruction()), result });
+}
+
+bool MemALUExec::HasWork(const CPU& cpu) const {
+    return !cpu.queues.preMemALU.entries.is_empty();
+}
+
+uint64_t MemALUExec::NextEvent(const CPU& cpu) const {
+    return HasWork(cpu) ? cpu.GetCycle() : CPU::Never; // Single-cycle unit
 }
 
-void MemALUExec::Consume() {
-    if (!cpu->queues.preMemALU.entries.is_empty())
-        slot = cpu->queues.preMemALU.entries.pop_front().instruction;
+void MemALUExec::Consume(CPU& cpu) {
+    if (!cpu.queues.preMemALU.entries.is_empty())
+        slot = cpu.queues.preMemALU.entries.pop_front().instruction;
 }
 
-void MemALUExec::Produce() {
+void MemALUExec::Produce(CPU& cpu) {
     if (slot.IsNop()) return;
 
-    uint32_t memAddr = (uint32_t) slot.ExecuteResult(*cpu);
+    uint32_t memAddr = (uint32_t) slot.ExecuteResult(cpu);
 
-    cpu->queues.preMem.entries.push_back(BufferEntry::PreMem{ std::move(slot), memAddr });    
+    cpu.queues.preMem.entries.push_back(BufferEntry::PreMem{ std::exchange(slot, Instruction()), memAddr });    
 }
 
-void MemExec::Consume() {
-    if (!cpu->queues.preMem.entries.is_empty())
-        slot = cpu->queues.preMem.entries.pop_front();
+bool MemExec::HasWork(const CPU& cpu) const {
+    return !cpu.queues.preMem.entries.is_empty();
 }
 
-void MemExec::Produce() {
+uint64_t MemExec::NextEvent(const CPU& cpu) const {
+    return HasWork(cpu) ? cpu.GetCycle() : CPU::Never; // Single-cycle unit
+}
+
+void MemExec::Consume(CPU& cpu) {
+    if (!cpu.queues.preMem.entries.is_empty())
+        slot = cpu.queues.preMem.entries.pop_front();
+}
+
+void MemExec::Produce(CPU& cpu) {
     if (!slot.has_value()) return;
 
     if (slot->instruction.IsStore()) {
-        cpu->Mem(slot->address) = cpu->Reg(slot->instruction.GetFormat<ISA::IType>().rt);
+        cpu.Store(slot->address, cpu.Reg(slot->instruction.GetFormat<ISA::IType>().rt));
+        cpu.RemoveLocks(slot->instruction); // Stores never reach writeback, so they finish here
     } else if (slot->instruction.IsLoad()) {
-        int32_t result = cpu->Mem(slot->address);
-        cpu->queues.postMem.entries.push_back(BufferEntry::PostMem{ slot->instruction, result });
+        int32_t result = cpu.Mem(slot->address);
+        cpu.queues.postMem.entries.push_back(BufferEntry::PostMem{ slot->instruction, result });
     }
 
     slot.reset();
 }
 
-void WritebackExec::Consume() {
-    if (!cpu->queues.postALU.entries.is_empty())
-        slotALU = cpu->queues.postALU.entries.pop_front();
+bool WritebackExec::HasWork(const CPU& cpu) const {
+    return !cpu.queues.postALU.entries.is_empty() || !cpu.queues.postMem.entries.is_empty();
+}
+
+uint64_t WritebackExec::NextEvent(const CPU& cpu) const {
+    return HasWork(cpu) ? cpu.GetCycle() : CPU::Never; // Single-cycle unit
+}
+
+void WritebackExec::Consume(CPU& cpu) {
+    if (!cpu.queues.postALU.entries.is_empty())
+        slotALU = cpu.queues.postALU.entries.pop_front();
 
-    if (!cpu->queues.postMem.entries.is_empty())
-        slotMem = cpu->queues.postMem.entries.pop_front();
+    if (!cpu.queues.postMem.entries.is_empty())
+        slotMem = cpu.queues.postMem.entries.pop_front();
 }
 
-void WritebackExec::Produce() {
+void WritebackExec::Produce(CPU& cpu) {
     // We can assume affects has a value because it will not reach WB if it does not
     if (slotALU.has_value()) {
-        const auto [deps, affects] = slotALU->instruction.GetDeps();
-        cpu->Reg(affects.value()) = slotALU->result;
+        cpu.Reg(slotALU->instruction.DestReg()) = slotALU->result;
         
-        cpu->RemoveLocks(slotALU->instruction);
+        cpu.RemoveLocks(slotALU->instruction);
         slotALU.reset();
     }
 
     if (slotMem.has_value()) {
-        const auto [deps, affects] = slotMem->instruction.GetDeps();
-        cpu->Reg(affects.value()) = slotMem->result;
+        cpu.Reg(slotMem->instruction.DestReg()) = slotMem->result;
 
-        cpu->RemoveLocks(slotMem->instruction);
+        cpu.RemoveLocks(slotMem->instruction);
         slotMem.reset();
     }
-}
\ No newline at end of file
+}
+// Defined here so that every stage call inlines into the cycle
+void CPU::Clock() {
+    Clock<DefaultPipelineOrder>();
+}
+
+uint64_t CPU::NextEventCycle() const {
+    return DefaultPipelineOrder::NextEvent(*this);
+}
+
+bool CPU::IsPipelineEmpty() const {
+    return !executors.fetch.IsStalled()
+        && !executors.fetch.IsExecuted()
+        && !executors.issue.HasWork(*this)
+        && !executors.alu.HasWork(*this)
+        && !executors.memALU.HasWork(*this)
+        && !executors.mem.HasWork(*this)
+        && !executors.writeback.HasWork(*this);
+}
+
+uint64_t CPU::Drain() {
+    const uint64_t start = cycle;
+    const bool wasBroken = executors.fetch.isBroken;
+
+    executors.fetch.isBroken = true; // Holds fetch; a waiting branch still executes
+
+    while (!IsPipelineEmpty())
+        Clock();
+
+    executors.fetch.isBroken = wasBroken;
+    return cycle - start;
+}
+
+CPU CPU::Reconfigured(const PipelineConfig& newConfig) {
+    newConfig.Validate();
+    Drain();
+
+    CPU next(pc, newConfig);
+    next.program = program;
+    next.memory = memory;
+    next.registers = registers;
+    next.rawTextBase = rawTextBase;
+    next.rawText = rawText;
+    next.codeGeneration = codeGeneration + 1;
+    next.cycle = cycle;
+    next.stageCalls = stageCalls;
+    next.stageSkips = stageSkips;
+    next.skippedCycles = skippedCycles;
+    next.executors.fetch.isBroken = executors.fetch.isBroken;
+    next.executors.fetch.fetched = executors.fetch.fetched;
+
+    return next;
+}
@@ -2,90 +2,97 @@
 
 #include "ISA.hpp"
 #include "Instruction.hpp"
-#include <functional>
 #include "Buffer.hpp"
+#include "PipelineConfig.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace SPIMDF {
     class CPU;
 
-    struct Executor {
-        CPU* cpu;
-
-        Executor(CPU& cpu): cpu(&cpu) { };
-        virtual ~Executor() { };
-
-        virtual void Consume() = 0;
-        virtual void Produce() = 0;
-    };
-
-    struct FetchExec final : Executor {
-        Instruction slot1;
-        Instruction slot2;
+    // Pipeline stages. Each cycle every stage Consume()s its inputs, then every stage Produce()s its outputs
+    // (see CPU::Clock and PipelineOrder). Stages are plain structs called directly, and get the CPU passed in.
+    // HasWork() is checked just before the stage's Consume(); a stage without work is skipped for the whole
+    // cycle, so it must only return false when both Consume() and Produce() would do nothing.
+    // NextEvent() is the first cycle, at or after the current one, in which the stage could change any state
+    // if nothing else in the pipeline changed first. CPU::NextEventCycle() uses it to skip quiescent cycles.
+    struct FetchExec {
+        std::array<Instruction, PipelineConfig::MaxFetchWidth> slots; // The first numSlots are filled
+        std::size_t numSlots = 0;
         Instruction staller = Instruction::Create<ISA::NOP>(0);
         Instruction executed = Instruction::Create<ISA::NOP>(0);
 
         bool isBroken = false;
+        uint64_t fetched = 0; // Instructions taken out of the program, NOPs and branches included. Nothing is
+                              // speculative, so once the pipeline drains every one of them has retired.
 
-        FetchExec(CPU& cpu) : Executor(cpu) { };
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
         
         bool IsStalled() const;
         bool IsExecuted() const;
 
-        bool HasStallerPreIssueHazard() const;
-
-        private:
-        void SetStaller(const Instruction& instr);
+        bool HasStallerPreIssueHazard(const CPU& cpu) const;
     };
 
-    struct IssueExec final : Executor {
-        Instruction slot1;
-        Instruction slot2;
+    struct IssueExec {
+        std::array<Instruction, PipelineConfig::MaxIssueWidth> slots; // The first numSlots are filled, oldest first
+        std::size_t numSlots = 0;
 
-        IssueExec(CPU& cpu) : Executor(cpu) { };
 
         // bool MapActiveInstructions(const std::function<bool(const Instruction&)>& func) const;
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
+
+        // Picks the pre-issue positions that can issue this cycle, oldest first. Returns how many.
+        std::size_t Select(const CPU& cpu, std::array<std::size_t, PipelineConfig::MaxIssueWidth>& selected) const;
     };
 
-    struct ALUExec final : Executor {
+    struct ALUExec {
         Instruction slot;
 
-        ALUExec(CPU& cpu) : Executor(cpu) { };
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
     };
 
-    struct MemALUExec final : Executor {
+    struct MemALUExec {
         Instruction slot;
 
-        MemALUExec(CPU& cpu) : Executor(cpu) { };
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
     };
 
-    struct MemExec final : Executor {
+    struct MemExec {
         std::optional<BufferEntry::PreMem> slot;
 
-        MemExec(CPU& cpu) : Executor(cpu) { };
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
     };
 
-    struct WritebackExec final : Executor {
+    struct WritebackExec {
         std::optional<BufferEntry::PostALU> slotALU;
         std::optional<BufferEntry::PostMem> slotMem;
 
-        WritebackExec(CPU& cpu) : Executor(cpu) { };
 
-        void Consume() override;
-        void Produce() override;
+        bool HasWork(const CPU& cpu) const;
+        uint64_t NextEvent(const CPU& cpu) const;
+        void Consume(CPU& cpu);
+        void Produce(CPU& cpu);
     };
 }
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "Functional.hpp"
+#include "CPU.hpp"
+#include "ISA.hpp"
+#include <array>
+
+using namespace SPIMDF;
+
+namespace {
+    void CountBlock(std::vector<uint64_t>& counts, uint32_t id, uint64_t instrs) {
+        if (id >= counts.size())
+            counts.resize(id + 1);
+
+        counts[id] += instrs;
+    }
+}
+
+FunctionalEngine::FunctionalEngine(CPU& cpu)
+: cpu(cpu)
+, halted(cpu.executors.fetch.isBroken)
+{ }
+
+bool FunctionalEngine::EnableJit(uint32_t hotThreshold) {
+    if (!JitCompiler::Available)
+        return false;
+
+    this->hotThreshold = hotThreshold > 0 ? hotThreshold : 1;
+
+    if (jit == nullptr)
+        jit = std::make_unique<JitCompiler>();
+
+    return true;
+}
+
+bool FunctionalEngine::Step() {
+    if (halted)
+        return false;
+
+    const Instruction& instr = cpu.FetchInstr(cpu.GetPC());
+
+    // Branch executors expect PC to already point past the branch, as it does after fetch
+    cpu.RelJump(4);
+
+    switch (instr.opcode) {
+        case ISA::Opcode::BRK:
+            halted = true;
+            break;
+        case ISA::Opcode::NOP:
+            break;
+        case ISA::Opcode::LW: {
+            const uint32_t addr = static_cast<uint32_t>(instr.ExecuteResult(cpu));
+            cpu.Reg(instr.DestReg()) = cpu.Mem(addr);
+            break;
+        }
+        case ISA::Opcode::SW: {
+            const uint32_t addr = static_cast<uint32_t>(instr.ExecuteResult(cpu));
+            cpu.Store(addr, cpu.Reg(instr.GetFormat<ISA::IType>().rt));
+            break;
+        }
+        default:
+            if (instr.IsJump())
+                instr.Execute(cpu);
+            else
+                cpu.Reg(instr.DestReg()) = instr.ExecuteResult(cpu);
+    }
+
+    retired++;
+    return !halted;
+}
+
+uint64_t FunctionalEngine::Run(uint64_t maxInstrs) {
+    // Indexed by ISA::Opcode, then Block::EndOfBlock
+    static const std::array<const void*, Block::NumHandlers> handlers = {
+          &&J, &&JR, &&BEQ, &&BLTZ, &&BGTZ, &&SW, &&LW, &&SLL, &&SRL, &&SRA, &&NOP, &&BRK
+        , &&ADD, &&SUB, &&MUL, &&AND, &&OR, &&XOR, &&NOR, &&SLT, &&ADDI, &&ANDI, &&ORI, &&XORI
+        , &&EndOfBlock
+    };
+
+    const uint64_t start = retired;
+
+    if (halted)
+        return 0;
+
+    if (blocks.Validate(cpu) && jit != nullptr)
+        jit->Reset(); // Native code belongs to the dropped blocks
+
+    int32_t* const regs = &cpu.Reg(0);
+    Block* block = &blocks.Get(cpu, cpu.GetPC(), handlers.data());
+    const Block::Op* op = nullptr;
+    uint32_t pc = block->start; // Only kept up to date when leaving the loop
+
+    // Arithmetic is done unsigned where signed overflow would be undefined; the results are the same bits
+    #define R(X) cpu.Reg(op->X)
+    #define U(X) static_cast<uint32_t>(cpu.Reg(op->X))
+    #define NEXT() goto *(++op)->handler
+    #define FOLLOW(NEXT_BLOCK, ADDR) \
+        if (block->NEXT_BLOCK == nullptr) \
+            block->NEXT_BLOCK = &blocks.Get(cpu, block->ADDR, handlers.data()); \
+        block = block->NEXT_BLOCK; \
+        goto EnterBlock
+
+    EnterBlock:
+        if (retired - start + block->length > maxInstrs) { // Finish one instruction at a time
+            pc = block->start;
+            goto Exit;
+        }
+
+        retired += block->length;
+
+        if (profile != nullptr)
+            CountBlock(*profile, block->id, block->length);
+
+        if (block->native == nullptr && jit != nullptr && ++block->heat == hotThreshold) {
+            block->native = jit->Compile(*block);
+            compiledBlocks += block->native != nullptr;
+        }
+
+        if (block->native != nullptr) {
+            pc = block->native(regs, &cpu);
+
+            if (pc == block->target)
+                goto Taken;
+            if (pc == block->fallthrough)
+                goto Fallthrough;
+
+            goto Indirect;
+        }
+
+        op = block->ops.data();
+        goto *op->handler;
+
+    Taken:       FOLLOW(takenBlock, target);
+    Fallthrough: FOLLOW(fallthroughBlock, fallthrough);
+
+    Indirect: // To pc
+        if (block->indirectBlock == nullptr || block->indirectTarget != pc) {
+            block->indirectTarget = pc;
+            block->indirectBlock = &blocks.Get(cpu, pc, handlers.data());
+        }
+
+        block = block->indirectBlock;
+        goto EnterBlock;
+
+    // Category 1
+    J:    goto Taken;
+    JR:   pc = U(b); goto Indirect;
+    BEQ:  if (R(b) == R(a)) goto Taken; goto Fallthrough;
+    BLTZ: if (R(b) < 0) goto Taken; goto Fallthrough;
+    BGTZ: if (R(b) > 0) goto Taken; goto Fallthrough;
+    SW:   cpu.Store(U(b) + op->imm, R(a)); NEXT();
+    LW:   R(a) = cpu.Mem(U(b) + op->imm); NEXT();
+    SLL:  R(a) = static_cast<int32_t>(U(c) << op->imm); NEXT();
+    SRL:  R(a) = static_cast<int32_t>(U(c) >> op->imm); NEXT();
+    SRA:  R(a) = R(c) >> op->imm; NEXT();
+    NOP:  NEXT();
+    BRK:
+        halted = true;
+        pc = block->fallthrough;
+        goto Exit;
+
+    // Category 2
+    ADD:  R(a) = static_cast<int32_t>(U(b) + U(c)); NEXT();
+    SUB:  R(a) = static_cast<int32_t>(U(b) - U(c)); NEXT();
+    MUL:  R(a) = static_cast<int32_t>(U(b) * U(c)); NEXT();
+    AND:  R(a) = R(b) & R(c); NEXT();
+    OR:   R(a) = R(b) | R(c); NEXT();
+    XOR:  R(a) = R(b) ^ R(c); NEXT();
+    NOR:  R(a) = ~(R(b) | R(c)); NEXT();
+    SLT:  R(a) = R(b) < R(c); NEXT();
+    ADDI: R(a) = static_cast<int32_t>(U(b) + static_cast<uint32_t>(op->imm)); NEXT();
+    ANDI: R(a) = static_cast<int32_t>(U(b) & static_cast<uint32_t>(op->imm)); NEXT(); // Same extension as the executor
+    ORI:  R(a) = static_cast<int32_t>(U(b) | static_cast<uint32_t>(op->imm)); NEXT();
+    XORI: R(a) = static_cast<int32_t>(U(b) ^ static_cast<uint32_t>(op->imm)); NEXT();
+
+    EndOfBlock: goto Fallthrough;
+
+    #undef R
+    #undef U
+    #undef NEXT
+    #undef FOLLOW
+
+    Exit:
+    cpu.Jump(pc);
+
+    // The last partial block. It is shorter than the block, so it never reaches the block's jump.
+    const uint64_t beforeTail = retired;
+
+    while (retired - start < maxInstrs && Step())
+        ;
+
+    if (profile != nullptr && retired != beforeTail)
+        CountBlock(*profile, block->id, retired - beforeTail);
+
+    return retired - start;
+}
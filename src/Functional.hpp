@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BlockCache.hpp"
+#include "Jit.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SPIMDF {
+    class CPU;
+
+    // Instruction-set simulator without a timing model: runs whole instructions on the CPU's registers, memory
+    // and PC, with no queues, locks or trace. It always stops on an instruction boundary, so the pipeline can
+    // take over from there after CPU::ResetPipeline(), and the engine can take over from a pipeline after
+    // CPU::Drain().
+    // Step() runs one instruction through the same Executors as the pipeline. Run() interprets translated
+    // blocks (see BlockCache) with threaded dispatch, or runs their native code once they are hot and the JIT
+    // is enabled. Both must match the Executors exactly.
+    class FunctionalEngine {
+        CPU& cpu;
+        uint64_t retired = 0;
+        uint64_t compiledBlocks = 0;
+        bool halted;
+
+        BlockCache blocks;
+        std::unique_ptr<JitCompiler> jit; // Null unless enabled
+        std::vector<uint64_t>* profile = nullptr;
+        uint32_t hotThreshold = 0; // Interpreted runs of a block before it is compiled
+
+        public:
+        static constexpr uint32_t DefaultHotThreshold = 16;
+
+        // Starts from the CPU's current PC. A CPU whose fetch stage already hit BREAK starts halted.
+        explicit FunctionalEngine(CPU& cpu);
+
+        // Runs the instruction at PC. Returns false once BREAK has been run.
+        bool Step();
+
+        // Runs up to maxInstrs instructions, stopping early at BREAK. Returns the number run.
+        // Uses GNU labels as values (GCC and Clang).
+        uint64_t Run(uint64_t maxInstrs);
+
+        // Makes Run() compile blocks to native code once they have been interpreted hotThreshold times.
+        // Returns false, leaving the engine interpreting, if there is no JIT for this host.
+        bool EnableJit(uint32_t hotThreshold = DefaultHotThreshold);
+
+        // While set, Run() adds the instructions it runs in each block to counts[block id], growing counts as
+        // needed. Step() does not count. Ids are only stable while the program does not change.
+        void SetBlockProfile(std::vector<uint64_t>* counts) { profile = counts; };
+
+        uint64_t GetRetired() const { return retired; };
+        uint64_t GetCompiledBlocks() const { return compiledBlocks; };
+        bool IsHalted() const { return halted; };
+    };
+}
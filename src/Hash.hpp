@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace SPIMDF {
+    namespace detail {
+        inline constexpr uint64_t Prime64_1 = 0x9E3779B185EBCA87ull;
+        inline constexpr uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4Full;
+        inline constexpr uint64_t Prime64_3 = 0x165667B19E3779F9ull;
+        inline constexpr uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ull;
+        inline constexpr uint64_t Prime64_5 = 0x27D4EB2F165667C5ull;
+
+        constexpr uint64_t Rotl64(uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline uint64_t Read64(const char* p) {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v; // Little endian hosts only
+        }
+
+        inline uint32_t Read32(const char* p) {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        constexpr uint64_t XXH64Round(uint64_t acc, uint64_t input) {
+            acc += input * Prime64_2;
+            acc = Rotl64(acc, 31);
+            return acc * Prime64_1;
+        }
+
+        constexpr uint64_t XXH64Merge(uint64_t acc, uint64_t val) {
+            acc ^= XXH64Round(0, val);
+            return acc * Prime64_1 + Prime64_4;
+        }
+    }
+
+    // XXH64 (https://github.com/Cyan4973/xxHash), used to key cached artifacts by file contents
+    inline uint64_t XXH64(std::string_view input, uint64_t seed = 0) {
+        using namespace detail;
+
+        const char* p = input.data();
+        const char* const end = p + input.size();
+        uint64_t h;
+
+        if (input.size() >= 32) {
+            uint64_t v1 = seed + Prime64_1 + Prime64_2;
+            uint64_t v2 = seed + Prime64_2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - Prime64_1;
+
+            for (; end - p >= 32; p += 32) {
+                v1 = XXH64Round(v1, Read64(p));
+                v2 = XXH64Round(v2, Read64(p + 8));
+                v3 = XXH64Round(v3, Read64(p + 16));
+                v4 = XXH64Round(v4, Read64(p + 24));
+            }
+
+            h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+            h = XXH64Merge(h, v1);
+            h = XXH64Merge(h, v2);
+            h = XXH64Merge(h, v3);
+            h = XXH64Merge(h, v4);
+        } else {
+            h = seed + Prime64_5;
+        }
+
+        h += input.size();
+
+        for (; end - p >= 8; p += 8)
+            h = Rotl64(h ^ XXH64Round(0, Read64(p)), 27) * Prime64_1 + Prime64_4;
+
+        if (end - p >= 4) {
+            h = Rotl64(h ^ (Read32(p) * Prime64_1), 23) * Prime64_2 + Prime64_3;
+            p += 4;
+        }
+
+        for (; p != end; p++)
+            h = Rotl64(h ^ (static_cast<uint8_t>(*p) * Prime64_5), 11) * Prime64_1;
+
+        h ^= h >> 33;
+        h *= Prime64_2;
+        h ^= h >> 29;
+        h *= Prime64_3;
+        h ^= h >> 32;
+
+        return h;
+    }
+}
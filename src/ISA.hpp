@@ -45,33 +45,44 @@ xori 1011
 #include <optional>
 #include <type_traits>
 #include <cstdint>
-#include <cmath>
 #include <string>
 #include <sstream>
 #include <variant>
+#include <vector>
 
 namespace SPIMDF {
-    inline int32_t FromTwosComp(std::string mach) {
-        int32_t val = 0;
-        
-        for (size_t i = 0; i < mach.size(); i++) {
-            if (mach[mach.size() - i - 1] == '1') {
-                if (i != mach.size() - 1)
-                    val += std::pow(2, i);
-                else
-                    val -= std::pow(2, i); // MSB is negative its normal power
-            }
-        }
-
-        return val;
-    }
-
     namespace ISA {
         using namespace std;
+        struct RType;
+        struct IType;
+        struct JType;
+
+        // A packed 32-bit machine word. Bit 31 is the first character of the textual encoding.
+        struct MachineWord {
+            uint32_t bits;
+        };
+
+        // Field extractors for packed machine words
+        namespace Field {
+            constexpr uint8_t  Opcode(uint32_t w) { return static_cast<uint8_t>(w >> 26); }
+            constexpr uint8_t  RS(uint32_t w)     { return static_cast<uint8_t>((w >> 21) & 0x1F); }
+            constexpr uint8_t  RT(uint32_t w)     { return static_cast<uint8_t>((w >> 16) & 0x1F); }
+            constexpr uint8_t  RD(uint32_t w)     { return static_cast<uint8_t>((w >> 11) & 0x1F); }
+            constexpr uint8_t  SA(uint32_t w)     { return static_cast<uint8_t>((w >> 6) & 0x1F); }
+            constexpr uint8_t  Func(uint32_t w)   { return static_cast<uint8_t>(w & 0x3F); }
+            constexpr int16_t  Imm(uint32_t w)    { return static_cast<int16_t>(w & 0xFFFF); }
+            constexpr int32_t  Index(uint32_t w)  { return static_cast<int32_t>(w << 6) >> 6; } // Sign extend 26 bits
+
+            constexpr bool IsBreak(uint32_t w) { return Opcode(w) == 0b010101; }
+
+            static_assert(Opcode(0b010101u << 26) == 0b010101);
+            static_assert(Imm(0xFFFF) == -1);
+            static_assert(Index(0x03FFFFFF) == -1 && Index(0x01FFFFFF) == 0x01FFFFFF);
+        }
 
         inline constexpr uint64_t Var = static_cast<uint64_t>(-1);
         // The following are definitions for defining dependencies and affections
-        enum class Dep {
+        enum class Dep : uint8_t {
               RS
             , RT
             , RD
@@ -95,7 +106,7 @@ namespace SPIMDF {
         }
 
         template<typename Format>
-        uint8_t ParseRegFromFormat(const Format& format, Dep dep) {
+        constexpr uint8_t ParseRegFromFormat(const Format& format, Dep dep) {
             if (dep == Dep::RT) return format.rt;
             if (dep == Dep::RS) return format.rs;
             if constexpr (std::is_same_v<Format, RType>) {
@@ -105,10 +116,39 @@ namespace SPIMDF {
             return 255;
         }
 
+        template<typename Format>
+        constexpr uint32_t DepMask(const Format& format, Dep dep) {
+            if (dep == Dep::None)
+                return 0;
+
+            const uint8_t reg = ParseRegFromFormat(format, dep);
+            return reg < 32 ? 1u << reg : 0;
+        }
+
+        // Bit r is set if the instruction reads register r
+        template<typename Format>
+        constexpr uint32_t ReadMask(const Format& format) {
+            if constexpr (std::is_same_v<Format, JType>)
+                return 0;
+            else {
+                const auto [dep1, dep2] = format.Dependencies();
+                return DepMask(format, dep1) | DepMask(format, dep2);
+            }
+        }
+
+        // Bit r is set if the instruction writes register r
+        template<typename Format>
+        constexpr uint32_t WriteMask(const Format& format) {
+            if constexpr (std::is_same_v<Format, JType>)
+                return 0;
+            else
+                return DepMask(format, format.Affects());
+        }
+
         // Get deps in the format of [vector, uint8_t] => deps, affects
         template<typename Format>
         std::tuple<std::vector<uint8_t>, std::optional<uint8_t>> ParseFormatDeps(const Format& format) {
-            auto tup = std::tuple<std::vector<uint8_t>, std::optional<uint8_t>>({}, std::nullopt);
+            auto tup = std::tuple<std::vector<uint8_t>, std::optional<uint8_t>>(std::vector<uint8_t>(), std::nullopt);
             auto& [deps, affects] = tup;
 
             if constexpr (std::is_same_v<Format, JType>) // JType has no dependencies/affects
@@ -117,14 +157,14 @@ namespace SPIMDF {
                 deps.reserve(2);
 
                 // Get all depended registers
-                for (const Dep& d : format.dependencies) {
+                for (const Dep d : format.Dependencies()) {
                     if (d != Dep::None)
                         deps.push_back(ParseRegFromFormat(format, d));
                 }
 
                 // Get affected register if it exists
-                if (format.affects != Dep::None)
-                    affects = ParseRegFromFormat(format, format.affects);
+                if (format.Affects() != Dep::None)
+                    affects = ParseRegFromFormat(format, format.Affects());
 
                 return tup;
             }
@@ -143,67 +183,73 @@ namespace SPIMDF {
         //         std::ostringstream ss;
 
         //         ss << "\tDepends on: " 
-        //             << depStr(format.dependencies[0]) << ", " 
-        //             << depStr(format.dependencies[1])
-        //             << ".\tAffects: " << depStr(format.affects);
+        //             << depStr(format.Dependencies()[0]) << ", " 
+        //             << depStr(format.Dependencies()[1])
+        //             << ".\tAffects: " << depStr(format.Affects());
 
         //         return ss.str();
         //     }
         // } 
 
+        namespace detail {
+            // Dependency metadata is packed two bits per Dep alongside the register fields
+            constexpr uint32_t PackDep(Dep d) { return static_cast<uint32_t>(d); }
+            constexpr Dep UnpackDep(uint32_t bits) { return static_cast<Dep>(bits); }
+        }
+
+        // Formats are packed into a single 32-bit word so they are trivially copyable and cheap to pass by value
         struct RType {
             private:
-            std::array<uint_least8_t, 5> fields;
-            inline const static std::array<const char*, 5> names = { "rs", "rt", "rd", "sa", "func" };
+            static constexpr std::array<const char*, 5> names = { "rs", "rt", "rd", "sa", "func" };
 
             public:
-            std::array<Dep, 2> dependencies;
-            Dep affects;
-
-            uint_least8_t& rs   = fields[0];
-            uint_least8_t& rt   = fields[1];
-            uint_least8_t& rd   = fields[2];
-            uint_least8_t& sa   = fields[3];
-            uint_least8_t& func = fields[4];    
+            uint32_t rs   : 5;
+            uint32_t rt   : 5;
+            uint32_t rd   : 5;
+            uint32_t sa   : 5;
+            uint32_t func : 6;
 
-            constexpr RType(const RType& copy) : fields(copy.fields), dependencies(copy.dependencies), affects(copy.affects) { }
-            constexpr RType(const decltype(fields)& fields, const std::array<Dep, 2>& deps, Dep affects)
-                : fields(fields), dependencies(deps), affects(affects) { }
+            private:
+            uint32_t dep1Bits    : 2;
+            uint32_t dep2Bits    : 2;
+            uint32_t affectsBits : 2;
 
+            public:
+            RType() = default;
             constexpr RType(uint8_t rs, uint8_t rt, uint8_t rd, uint8_t sa, uint8_t func, const std::array<Dep, 2>& deps, Dep affects)
-                : fields({ 0, 0, 0, 0, 0})
-                , dependencies(deps)
-                , affects(affects)
-            {
-                this->rs = rs;
-                this->rt = rt;
-                this->rd = rd;
-                this->sa = sa;
-                this->func = func;
+                : rs(rs), rt(rt), rd(rd), sa(sa), func(func)
+                , dep1Bits(detail::PackDep(deps[0]))
+                , dep2Bits(detail::PackDep(deps[1]))
+                , affectsBits(detail::PackDep(affects))
+            { }
+
+            constexpr std::array<Dep, 2> Dependencies() const {
+                return { detail::UnpackDep(dep1Bits), detail::UnpackDep(dep2Bits) };
             }
 
-            RType& operator=(const RType& copy) {
-                fields = copy.fields;
-                return *this;
+            constexpr Dep Affects() const {
+                return detail::UnpackDep(affectsBits);
             }
 
             void Print() const {
+                const std::array<uint32_t, 5> fields{ rs, rt, rd, sa, func };
+
                 FieldRepPrint(fields.cbegin(), fields.cend(), names.cbegin());
             };
 
             // Factory function to define an instruction declaratively
             template<auto RS, auto RT, auto RD, auto SA, auto FUNC, Dep DEP1, Dep DEP2, Dep AFF, typename... Args>
             static RType Factory(Args&&... a) {
-                if constexpr ((std::is_same_v<Args, const std::string&> || ...)) {
+                if constexpr ((std::is_same_v<Args, const MachineWord&> || ...)) {
                     // Decode from machine code!
-                    std::string mach = std::get<0>(std::tie(a...)); // Get the machine code string, which will be the first argument
+                    const uint32_t mach = std::get<0>(std::tie(a...)).bits; // Get the machine word, which will be the first argument
                     
                     return RType(
-                          static_cast<uint8_t>(IsVar<RS>()   ? std::stoi(mach.substr(6, 5)  , nullptr, 2) : RS)
-                        , static_cast<uint8_t>(IsVar<RT>()   ? std::stoi(mach.substr(11, 5) , nullptr, 2) : RT)
-                        , static_cast<uint8_t>(IsVar<RD>()   ? std::stoi(mach.substr(16, 5) , nullptr, 2) : RD)
-                        , static_cast<uint8_t>(IsVar<SA>()   ? std::stoi(mach.substr(21, 5) , nullptr, 2) : SA)
-                        , static_cast<uint8_t>(IsVar<FUNC>() ? std::stoi(mach.substr(26, 6) , nullptr, 2) : FUNC)
+                          static_cast<uint8_t>(IsVar<RS>()   ? Field::RS(mach)   : RS)
+                        , static_cast<uint8_t>(IsVar<RT>()   ? Field::RT(mach)   : RT)
+                        , static_cast<uint8_t>(IsVar<RD>()   ? Field::RD(mach)   : RD)
+                        , static_cast<uint8_t>(IsVar<SA>()   ? Field::SA(mach)   : SA)
+                        , static_cast<uint8_t>(IsVar<FUNC>() ? Field::Func(mach) : FUNC)
                         , { DEP1, DEP2 }
                         , AFF
                     );
@@ -212,67 +258,67 @@ namespace SPIMDF {
                     std::array<uint32_t, sizeof...(Args)> args{ a... };
                     uint8_t curArg = 0;
 
-                    std::array<uint8_t, 5> fields {
+                    // Braced init so the arguments are consumed in order
+                    return RType{
                           static_cast<uint8_t>(IsVar<RS>()   ? args[curArg++] : RS)
                         , static_cast<uint8_t>(IsVar<RT>()   ? args[curArg++] : RT)
                         , static_cast<uint8_t>(IsVar<RD>()   ? args[curArg++] : RD)
                         , static_cast<uint8_t>(IsVar<SA>()   ? args[curArg++] : SA)
                         , static_cast<uint8_t>(IsVar<FUNC>() ? args[curArg] : FUNC)
+                        , { DEP1, DEP2 }
+                        , AFF
                     };
-
-                    return RType(fields, { DEP1, DEP2 }, AFF);
                 }
             }
         };
 
         struct IType {
             private:
-            std::tuple<uint_least8_t, uint_least8_t, int_least16_t> fields;
-            inline const static std::array<const char*, 3> names = { "rs", "rt", "imm" };
+            static constexpr std::array<const char*, 3> names = { "rs", "rt", "imm" };
 
             public:
-            std::array<Dep, 2> dependencies;
-            Dep affects;
-
-            uint_least8_t&  rs  = std::get<0>(fields);
-            uint_least8_t&  rt  = std::get<1>(fields);
-            int_least16_t& imm = std::get<2>(fields);    
-
+            uint32_t rs  : 5;
+            uint32_t rt  : 5;
+            int32_t  imm : 16;
 
-            constexpr IType(const IType& copy) : fields(copy.fields), dependencies(copy.dependencies), affects(copy.affects) { }
-            constexpr IType(const decltype(fields)& fields, const std::array<Dep, 2>& deps, Dep affects)
-                : fields(fields), dependencies(deps), affects(affects)
-            { };
+            private:
+            uint32_t dep1Bits    : 2;
+            uint32_t dep2Bits    : 2;
+            uint32_t affectsBits : 2;
 
+            public:
+            IType() = default;
             constexpr IType(uint8_t rs, uint8_t rt, int16_t imm, const std::array<Dep, 2>& deps, Dep affects)
-                : dependencies(deps), affects(affects)
-            {
-                this->rs = rs;
-                this->rt = rt;
-                this->imm = imm;
+                : rs(rs), rt(rt), imm(imm)
+                , dep1Bits(detail::PackDep(deps[0]))
+                , dep2Bits(detail::PackDep(deps[1]))
+                , affectsBits(detail::PackDep(affects))
+            { }
+
+            constexpr std::array<Dep, 2> Dependencies() const {
+                return { detail::UnpackDep(dep1Bits), detail::UnpackDep(dep2Bits) };
             }
 
-            IType& operator=(const IType& copy) {
-                fields = copy.fields;
-                return *this;
+            constexpr Dep Affects() const {
+                return detail::UnpackDep(affectsBits);
             }
 
             void Print() const {
-                std::array<int32_t, 3> fieldsArray{ rs, rt, imm };
+                const std::array<int32_t, 3> fields{ static_cast<int32_t>(rs), static_cast<int32_t>(rt), imm };
 
-                FieldRepPrint(fieldsArray.cbegin(), fieldsArray.cend(), names.cbegin());
+                FieldRepPrint(fields.cbegin(), fields.cend(), names.cbegin());
             };
             
             // Factory function to define an instruction declaratively
             template<auto RS, auto RT, auto IMM, Dep DEP1, Dep DEP2, Dep AFF, typename... Args>
             static IType Factory(Args&&... a) {
-                if constexpr ((std::is_same_v<Args, const std::string&> || ...)) {
+                if constexpr ((std::is_same_v<Args, const MachineWord&> || ...)) {
                     // Decode from machine code!
-                    std::string mach = std::get<0>(std::tie(a...)); // Get the machine code string, which will be the first argument
+                    const uint32_t mach = std::get<0>(std::tie(a...)).bits; // Get the machine word, which will be the first argument
                     return IType(
-                          static_cast<uint8_t>(IsVar<RS>()  ? std::stoi(mach.substr(6, 5)  , nullptr, 2) : RS)
-                        , static_cast<uint8_t>(IsVar<RT>()  ? std::stoi(mach.substr(11, 5) , nullptr, 2) : RT)
-                        , static_cast<int16_t>(IsVar<IMM>() ? FromTwosComp(mach.substr(16, 16))          : IMM)
+                          static_cast<uint8_t>(IsVar<RS>()  ? Field::RS(mach)  : RS)
+                        , static_cast<uint8_t>(IsVar<RT>()  ? Field::RT(mach)  : RT)
+                        , static_cast<int16_t>(IsVar<IMM>() ? Field::Imm(mach) : IMM)
                         , { DEP1, DEP2 }
                         , AFF
                     );
@@ -281,37 +327,30 @@ namespace SPIMDF {
                     std::array<int32_t, sizeof...(Args)> args{a...};     
                     char curArg = 0;
 
-                    std::tuple<uint_least8_t, uint_least8_t, uint_least16_t> fields {
+                    // Braced init so the arguments are consumed in order
+                    return IType{
                           static_cast<uint8_t>( IsVar<RS>() ? args[curArg++] : RS )
                         , static_cast<uint8_t>( IsVar<RT>() ? args[curArg++] : RT )
                         , static_cast<int16_t>(IsVar<IMM>() ? args[curArg++] : IMM)
+                        , { DEP1, DEP2 }
+                        , AFF
                     };
-
-                    return IType(fields, { DEP1, DEP2 }, AFF);
                 }
             }
         };
         
         struct JType {
             private:
-            std::array<int_least32_t, 1> fields;
-            inline const static std::array<const char*, 3> names = { "index" };
+            static constexpr std::array<const char*, 1> names = { "index" };
 
             public:
-            int_least32_t& index = fields[0];
+            int32_t index;
 
-            JType(const JType& copy) : fields(copy.fields) { }
-
-            JType(int32_t index) {
-                this->index = index;
-            }
-
-            JType& operator=(const JType& copy) {
-                fields = copy.fields;
-                return *this;
-            }
+            constexpr JType(int32_t index) : index(index) { }
 
             void Print() const {
+                const std::array<int32_t, 1> fields{ index };
+
                 FieldRepPrint(fields.cbegin(), fields.cend(), names.cbegin());
             };
             
@@ -325,12 +364,21 @@ namespace SPIMDF {
                 }
             }
 
-            static JType Decode(const std::string& mach) {
-                return JType(FromTwosComp(mach.substr(6, 26)));
+            static constexpr JType Decode(const MachineWord& mach) {
+                return JType(Field::Index(mach.bits));
             }
         };
 
-        
+        static_assert(sizeof(RType) == 4 && std::is_trivially_copyable_v<RType>);
+        static_assert(sizeof(IType) == 4 && std::is_trivially_copyable_v<IType>);
+        static_assert(sizeof(JType) == 4 && std::is_trivially_copyable_v<JType>);
+
+        static_assert(RType(1, 2, 3, 4, 5, { Dep::RS, Dep::RT }, Dep::RD).Affects() == Dep::RD);
+        static_assert(IType(1, 2, -3, { Dep::RS, Dep::None }, Dep::RT).imm == -3);
+        static_assert(ReadMask(RType(1, 2, 3, 0, 0, { Dep::RS, Dep::RT }, Dep::RD)) == 0b110);
+        static_assert(WriteMask(IType(1, 2, -3, { Dep::RS, Dep::None }, Dep::RT)) == 0b100);
+        static_assert(WriteMask(JType(0)) == 0);
+
         namespace detail {
             // Instruction Definitions (declarative)
             // Cat1
@@ -347,7 +395,7 @@ namespace SPIMDF {
             inline constexpr auto NOP  = JType::Factory<0>;
             inline constexpr auto BRK  = JType::Factory<1>;
 
-            #define DECODE_ARGS const std::string&
+            #define DECODE_ARGS const MachineWord&
 
             // Decode cat1
             inline constexpr auto Decode_J    = JType::Decode;
@@ -422,7 +470,7 @@ namespace SPIMDF {
         inline constexpr auto ORI  = &detail::ORI;
         inline constexpr auto XORI = &detail::XORI;
 
-        enum class Opcode {
+        enum class Opcode : uint8_t {
               J   
             , JR  
             , BEQ 
@@ -448,6 +496,39 @@ namespace SPIMDF {
             , ORI 
             , XORI
         };
+
+        inline constexpr std::size_t NumOpcodes = static_cast<std::size_t>(Opcode::XORI) + 1;
+
+        enum class Format : uint8_t {
+              R
+            , I
+            , J
+        };
+
+        // Which format struct holds an opcode's fields
+        constexpr Format FormatOf(Opcode opcode) {
+            switch (opcode) {
+                case Opcode::J:
+                case Opcode::NOP:
+                case Opcode::BRK:
+                    return Format::J;
+                case Opcode::JR:
+                case Opcode::SLL:
+                case Opcode::SRL:
+                case Opcode::SRA:
+                case Opcode::ADD:
+                case Opcode::SUB:
+                case Opcode::MUL:
+                case Opcode::AND:
+                case Opcode::OR:
+                case Opcode::XOR:
+                case Opcode::NOR:
+                case Opcode::SLT:
+                    return Format::R;
+                default:
+                    return Format::I;
+            }
+        }
     }
     
 }
\ No newline at end of file
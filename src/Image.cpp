@@ -0,0 +1,214 @@
+#include "Image.hpp"
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include "Instruction.hpp"
+#include "ISA.hpp"
+#include "Loader.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace SPIMDF;
+
+namespace {
+    constexpr uint32_t TextBase = 256;
+
+    void Write(const std::vector<Image::InstrRecord>& text, const std::vector<int32_t>& data, const char* imageFilename) {
+        Image::Header header;
+        header.magic = Image::Magic;
+        header.version = Image::Version;
+        header.recordSize = sizeof(Image::InstrRecord);
+        header.textBase = TextBase;
+        header.textCount = static_cast<uint32_t>(text.size());
+        header.dataBase = header.textBase + 4 * header.textCount;
+        header.dataCount = static_cast<uint32_t>(data.size());
+
+        std::ofstream output(imageFilename, std::ios::binary);
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(Image::InstrRecord));
+        output.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int32_t));
+
+        if (!output)
+            throw std::runtime_error(std::string("Failed to write image: ") + imageFilename);
+    }
+}
+
+Image::InstrRecord Image::ToRecord(const Instruction& instr) {
+    InstrRecord record{};
+    record.opcode = static_cast<uint8_t>(instr.opcode);
+
+    switch (ISA::FormatOf(instr.opcode)) {
+        case ISA::Format::J: {
+            const auto& format = instr.GetFormat<ISA::JType>();
+            record.index = format.index;
+            break;
+        }
+        case ISA::Format::R: {
+            const auto& format = instr.GetFormat<ISA::RType>();
+            record.rs = format.rs;
+            record.rt = format.rt;
+            record.rd = format.rd;
+            record.sa = format.sa;
+            record.func = format.func;
+            break;
+        }
+        case ISA::Format::I: {
+            const auto& format = instr.GetFormat<ISA::IType>();
+            record.rs = format.rs;
+            record.rt = format.rt;
+            record.imm = format.imm;
+            break;
+        }
+    }
+
+    return record;
+}
+
+Instruction Image::FromRecord(const InstrRecord& r) {
+    // The factories take their arguments by rvalue, so pass copies
+    const auto rs = [&] { return uint8_t{ r.rs }; };
+    const auto rt = [&] { return uint8_t{ r.rt }; };
+    const auto rd = [&] { return uint8_t{ r.rd }; };
+    const auto sa = [&] { return uint8_t{ r.sa }; };
+    const auto imm = [&] { return int16_t{ r.imm }; };
+
+    switch (static_cast<ISA::Opcode>(r.opcode)) {
+        // Category 1
+        case ISA::Opcode::J:    return Instruction::Create<ISA::J>(r.index);
+        case ISA::Opcode::JR:   return Instruction::Create<ISA::JR>(rs());
+        case ISA::Opcode::BEQ:  return Instruction::Create<ISA::BEQ>(rs(), rt(), imm());
+        case ISA::Opcode::BLTZ: return Instruction::Create<ISA::BLTZ>(rs(), imm());
+        case ISA::Opcode::BGTZ: return Instruction::Create<ISA::BGTZ>(rs(), imm());
+        case ISA::Opcode::SW:   return Instruction::Create<ISA::SW>(rs(), rt(), imm());
+        case ISA::Opcode::LW:   return Instruction::Create<ISA::LW>(rs(), rt(), imm());
+        case ISA::Opcode::SLL:  return Instruction::Create<ISA::SLL>(rt(), rd(), sa());
+        case ISA::Opcode::SRL:  return Instruction::Create<ISA::SRL>(rt(), rd(), sa());
+        case ISA::Opcode::SRA:  return Instruction::Create<ISA::SRA>(rt(), rd(), sa());
+        case ISA::Opcode::NOP:  return Instruction::Create<ISA::NOP>(r.index);
+        case ISA::Opcode::BRK:  return Instruction::Create<ISA::BRK>(r.index);
+
+        // Category 2
+        case ISA::Opcode::ADD:  return Instruction::Create<ISA::ADD>(rs(), rt(), rd());
+        case ISA::Opcode::SUB:  return Instruction::Create<ISA::SUB>(rs(), rt(), rd());
+        case ISA::Opcode::MUL:  return Instruction::Create<ISA::MUL>(rs(), rt(), rd());
+        case ISA::Opcode::AND:  return Instruction::Create<ISA::AND>(rs(), rt(), rd());
+        case ISA::Opcode::OR:   return Instruction::Create<ISA::OR>(rs(), rt(), rd());
+        case ISA::Opcode::XOR:  return Instruction::Create<ISA::XOR>(rs(), rt(), rd());
+        case ISA::Opcode::NOR:  return Instruction::Create<ISA::NOR>(rs(), rt(), rd());
+        case ISA::Opcode::SLT:  return Instruction::Create<ISA::SLT>(rs(), rt(), rd());
+        case ISA::Opcode::ADDI: return Instruction::Create<ISA::ADDI>(rs(), rt(), imm());
+        case ISA::Opcode::ANDI: return Instruction::Create<ISA::ANDI>(rs(), rt(), imm());
+        case ISA::Opcode::ORI:  return Instruction::Create<ISA::ORI>(rs(), rt(), imm());
+        case ISA::Opcode::XORI: return Instruction::Create<ISA::XORI>(rs(), rt(), imm());
+    }
+
+    throw std::runtime_error("Invalid opcode in image record: " + std::to_string(r.opcode));
+}
+
+bool Image::IsImage(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::array<char, 8> magic{};
+
+    return file.read(magic.data(), magic.size()) && magic == Magic;
+}
+
+void Image::Convert(const char* textFilename, const char* imageFilename) {
+    MappedFile input(textFilename);
+
+    if (!input.IsOpen())
+        throw std::runtime_error(std::string("File not found: ") + textFilename);
+
+    Convert(input.View(), imageFilename);
+}
+
+void Image::Convert(std::string_view input, const char* imageFilename) {
+    std::vector<InstrRecord> text;
+    std::vector<int32_t> data;
+    bool inText = true; // Everything after the first BRK is data
+
+    ForEachMachineWord(input, [&](uint32_t mach, std::string_view) {
+        if (inText) {
+            const Instruction instr = DecodeMachineCode(mach);
+
+            text.push_back(ToRecord(instr));
+            inText = instr.opcode != ISA::Opcode::BRK;
+        } else {
+            data.push_back(static_cast<int32_t>(mach));
+        }
+
+        return true;
+    });
+
+    Write(text, data, imageFilename);
+}
+
+void Image::Save(const CPU& cpu, const char* imageFilename) {
+    std::vector<InstrRecord> text;
+    std::vector<int32_t> data;
+    uint32_t addr = TextBase;
+
+    for (const Instruction* instr; (instr = cpu.FindInstr(addr)) != nullptr; addr += 4) {
+        text.push_back(ToRecord(*instr));
+
+        if (instr->opcode == ISA::Opcode::BRK) {
+            addr += 4;
+            break;
+        }
+    }
+
+    // The data words follow the text without gaps
+    const auto& memory = cpu.GetAllMem();
+
+    for (auto it = memory.lower_bound(addr); it != memory.end() && it->first == addr; ++it, addr += 4)
+        data.push_back(it->second);
+
+    Write(text, data, imageFilename);
+}
+
+void Image::Load(const char* imageFilename, CPU& cpu) {
+    MappedFile input(imageFilename);
+
+    if (!input.IsOpen())
+        throw std::runtime_error(std::string("File not found: ") + imageFilename);
+
+    const std::string_view bytes = input.View();
+    Header header;
+
+    if (bytes.size() < sizeof(Header))
+        throw std::runtime_error("Image too small for header");
+
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+
+    if (header.magic != Magic)
+        throw std::runtime_error("Not a program image");
+    if (header.version != Version)
+        throw std::runtime_error("Unsupported image version " + std::to_string(header.version));
+    if (header.recordSize != sizeof(InstrRecord))
+        throw std::runtime_error("Unsupported image record size");
+
+    const std::size_t textBytes = std::size_t{ header.textCount } * sizeof(InstrRecord);
+    const std::size_t dataBytes = std::size_t{ header.dataCount } * sizeof(int32_t);
+
+    if (bytes.size() < sizeof(Header) + textBytes + dataBytes)
+        throw std::runtime_error("Image truncated");
+
+    const char* text = bytes.data() + sizeof(Header);
+    const char* data = text + textBytes;
+
+    for (uint32_t i = 0; i < header.textCount; i++) {
+        InstrRecord record;
+        std::memcpy(&record, text + i * sizeof(InstrRecord), sizeof(InstrRecord));
+
+        cpu.LoadInstr(header.textBase + 4 * i, FromRecord(record));
+    }
+
+    for (uint32_t i = 0; i < header.dataCount; i++) {
+        int32_t datum;
+        std::memcpy(&datum, data + i * sizeof(int32_t), sizeof(int32_t));
+
+        cpu.LoadMem(header.dataBase + 4 * i, datum);
+    }
+}
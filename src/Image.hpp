@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace SPIMDF {
+    class CPU;
+    class Instruction;
+
+    // Binary program image. Layout (host byte order):
+    //   Header
+    //   Text section: header.textCount InstrRecords, loaded at header.textBase
+    //   Data section: header.dataCount int32_t words, loaded at header.dataBase
+    namespace Image {
+        inline constexpr std::array<char, 8> Magic = { 'S', 'P', 'I', 'M', 'D', 'F', 'I', 'M' };
+        inline constexpr uint32_t Version = 1;
+
+        struct Header {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t recordSize;
+            uint32_t textBase;
+            uint32_t textCount;
+            uint32_t dataBase;
+            uint32_t dataCount;
+        };
+
+        // Pre-decoded instruction. Fields that the opcode's format does not use are zero.
+        struct InstrRecord {
+            uint8_t opcode;
+            uint8_t rs;
+            uint8_t rt;
+            uint8_t rd;
+            uint8_t sa;
+            uint8_t func;
+            int16_t imm;
+            int32_t index;
+        };
+
+        static_assert(sizeof(Header) == 32);
+        static_assert(sizeof(InstrRecord) == 12);
+
+        InstrRecord ToRecord(const Instruction& instr);
+        Instruction FromRecord(const InstrRecord& record);
+
+        // Returns true if the file begins with the image magic
+        bool IsImage(const char* filename);
+
+        // Converts a textual ('0'/'1' words) program into an image
+        void Convert(const char* textFilename, const char* imageFilename);
+        void Convert(std::string_view text, const char* imageFilename);
+
+        // Writes the program already loaded into the CPU (text through the first BRK, then the data words
+        // after it) as an image, without decoding it again
+        void Save(const CPU& cpu, const char* imageFilename);
+
+        // Loads an image into the CPU's program and memory. Throws std::runtime_error on a malformed image.
+        void Load(const char* imageFilename, CPU& cpu);
+    }
+}
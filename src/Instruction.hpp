@@ -3,12 +3,14 @@
 #include "ISA.hpp"
 #include "Microcode.hpp"
 
-#include <functional>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <type_traits>
 #include <utility>
-#include <variant>
+#include <vector>
 
 namespace SPIMDF {
     namespace detail {
@@ -25,97 +27,66 @@ namespace SPIMDF {
 
     class Instruction {
         public:
-        using ResultCB_g = void(int32_t);
-        using Executor_g = void(CPU& cpu, const Instruction&, const std::function<ResultCB_g>&);
-        using Printer_g = std::string(const Instruction&);
-        using EP = std::pair<std::function<Executor_g>, std::function<Printer_g>>;
-
         using Deps_t = std::vector<uint8_t>;
         using Affects_t = std::optional<uint8_t>;
 
-        ISA::Opcode opcode;
-
         private:
-        std::function<Executor_g> executor;
-        std::function<Printer_g> printer;
-        std::variant<ISA::RType, ISA::IType, ISA::JType> format;
+        // Operands of whichever format the opcode uses (see ISA::FormatOf). Every format is a single
+        // packed word, so the instruction stays a small trivially copyable value.
+        union {
+            ISA::JType jType = ISA::JType(0);
+            ISA::RType rType;
+            ISA::IType iType;
+        };
+
+        // Registers read and written, precomputed so hazard checks are single ANDs
+        uint32_t readMask = 0;
+        uint32_t writeMask = 0;
 
         public:
-        template<class Format>
-        Instruction(ISA::Opcode opcode, Format&& fm, const EP& ep)
-            : opcode(opcode), format(fm), executor(ep.first), printer(ep.second)
-        { }
-
-        Instruction(const Instruction& copy)
-            : opcode(copy.opcode)
-            , executor(copy.executor)
-            , printer(copy.printer)
-            , format(copy.format)
-        { }
-
-        Instruction(Instruction&& other)
-            : opcode(other.opcode)
-            , executor(other.executor)
-            , printer(other.printer)
-            , format(other.format)
-        {
-            other.opcode = ISA::Opcode::NOP;
-            other.format = (*ISA::NOP)(0);
-            other.executor = Executors::NOP;
-            other.printer = Printers::NOP;
-        }
+        ISA::Opcode opcode = ISA::Opcode::NOP;
 
-        Instruction& operator=(const Instruction& copy) {
-            opcode = copy.opcode;
-            executor = copy.executor;
-            printer = copy.printer;
-            format = copy.format;
+        constexpr Instruction(ISA::Opcode opcode, const ISA::RType& fm)
+            : rType(fm), readMask(ISA::ReadMask(fm)), writeMask(ISA::WriteMask(fm)), opcode(opcode) { }
+        constexpr Instruction(ISA::Opcode opcode, const ISA::IType& fm)
+            : iType(fm), readMask(ISA::ReadMask(fm)), writeMask(ISA::WriteMask(fm)), opcode(opcode) { }
+        constexpr Instruction(ISA::Opcode opcode, const ISA::JType& fm)
+            : jType(fm), opcode(opcode) { }
 
-            return *this;
-        }
-
-        Instruction& operator=(Instruction&& other) {
-            opcode = other.opcode;
-            executor = other.executor;
-            printer = other.printer;
-            format = other.format;
-
-            other.opcode = ISA::Opcode::NOP;
-            other.format = (*ISA::NOP)(0);
-            other.executor = Executors::NOP;
-            other.printer = Printers::NOP;
-
-            return *this;
-        }
+        constexpr Instruction() = default; // A NOP
 
+        // Format must match ISA::FormatOf(opcode)
         template<class Format>
-        const Format& GetFormat() const {
-            return std::get<Format>(format);
+        constexpr const Format& GetFormat() const {
+            if constexpr (std::is_same_v<Format, ISA::RType>)
+                return rType;
+            else if constexpr (std::is_same_v<Format, ISA::IType>)
+                return iType;
+            else
+                return jType;
         }
 
         void Execute(CPU& cpu) const {
-            executor(cpu, *this, [](int32_t) { });
+            ExecutorTable[static_cast<std::size_t>(opcode)](cpu, *this);
         }
 
         int32_t ExecuteResult(CPU& cpu) const {
-            int32_t res = 0xDEAD;
-
-            const auto resultCB = [&](int32_t x) {
-                res = x;
-            };
+            return ExecutorTable[static_cast<std::size_t>(opcode)](cpu, *this);
+        }
 
-            executor(cpu, *this, resultCB);
+        uint32_t ReadMask() const { return readMask; }
+        uint32_t WriteMask() const { return writeMask; }
 
-            return res;
+        // The register this instruction writes. Only valid if WriteMask() != 0.
+        uint8_t DestReg() const {
+            return static_cast<uint8_t>(std::countr_zero(writeMask));
         }
 
         auto GetDeps() const {
-            if (std::holds_alternative<ISA::RType>(format)) {
-                return ISA::ParseFormatDeps(GetFormat<ISA::RType>());
-            } else if (std::holds_alternative<ISA::IType>(format)) {
-                return ISA::ParseFormatDeps(GetFormat<ISA::IType>());
-            } else {
-                return ISA::ParseFormatDeps(GetFormat<ISA::JType>());
+            switch (ISA::FormatOf(opcode)) {
+                case ISA::Format::R: return ISA::ParseFormatDeps(GetFormat<ISA::RType>());
+                case ISA::Format::I: return ISA::ParseFormatDeps(GetFormat<ISA::IType>());
+                default:             return ISA::ParseFormatDeps(GetFormat<ISA::JType>());
             }
         }
 
@@ -162,13 +133,20 @@ namespace SPIMDF {
             return opcode == ISA::Opcode::NOP;
         }
 
+        // Writes the assembly for this instruction into out (see Printers::MaxLength) and returns the end
+        char* Format(char* out) const {
+            return PrinterTable[static_cast<std::size_t>(opcode)](*this, out);
+        }
+
         std::string ToString(bool ignoreNop = false) const {
             if (opcode == ISA::Opcode::NOP && ignoreNop) {
                 return "";
             }
 
+            char buffer[Printers::MaxLength];
+
             // return printer(*this) + " " + GetDepsString();
-            return printer(*this);
+            return std::string(buffer, Format(buffer));
         }
         
         void Print() const {
@@ -179,7 +157,7 @@ namespace SPIMDF {
         static Instruction CreateFromFormat(const Format& format) {
             #define DEF_IN(X) \
             if constexpr (detail::SameFunctionPointer<Factory, ISA::X>()) \
-                return Instruction(ISA::Opcode::X, format, std::make_pair(std::function(Executors::X), std::function(Printers::X)))
+                return Instruction(ISA::Opcode::X, format)
             
             // Category 1
             DEF_IN(J);  
@@ -219,7 +197,7 @@ namespace SPIMDF {
         static Instruction Create(Args&&... args) {
             #define DEF_IN(X) \
             if constexpr (detail::SameFunctionPointer<Factory, ISA::X>()) \
-                return Instruction(ISA::Opcode::X, (*ISA::X)(std::forward<Args>(args)...), std::make_pair(std::function(Executors::X), std::function(Printers::X)))
+                return Instruction(ISA::Opcode::X, (*ISA::X)(std::forward<Args>(args)...))
             
             // Category 1
             DEF_IN(J);  
@@ -255,6 +233,8 @@ namespace SPIMDF {
             #undef DEF_IN
         }
 
-        Instruction() : Instruction(Create<ISA::NOP>(0)) { }; // Default to just a NOP instruction
     };
+
+    static_assert(std::is_trivially_copyable_v<Instruction>);
+    static_assert(sizeof(Instruction) <= 16);
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "IntervalSim.hpp"
+#include "CPU.hpp"
+#include "Functional.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace SPIMDF;
+
+namespace {
+    // The memory words the functional run wrote between two checkpoints, with their values at the later one.
+    // Each links to the next once that exists, so the deltas form a list in checkpoint order, which the
+    // workers walk and drop behind them as they go.
+    struct MemoryDelta {
+        std::vector<std::pair<uint32_t, int32_t>> writes;
+        std::shared_ptr<MemoryDelta> next; // Set before the next checkpoint is queued
+    };
+
+    // Memory is only sent as the delta since the previous checkpoint, so taking a checkpoint does not copy it
+    struct Checkpoint {
+        std::size_t index;
+        uint64_t warmup; // Instructions between the checkpoint and the interval
+        uint32_t pc;
+        std::array<int32_t, 32> registers;
+        std::shared_ptr<MemoryDelta> delta;
+    };
+
+    // Checkpoints from the functional run to the workers. Bounded, so the functional run cannot get far ahead
+    // of the workers and hold every checkpoint in memory at once.
+    class CheckpointQueue {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Checkpoint> pending;
+        std::size_t limit;
+        bool closed = false;
+
+        public:
+        explicit CheckpointQueue(std::size_t limit) : limit(limit) { };
+
+        void Push(Checkpoint&& checkpoint) {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return pending.size() < limit; });
+            pending.push_back(std::move(checkpoint));
+            changed.notify_all();
+        }
+
+        // No more pushes
+        void Close() {
+            std::lock_guard lock(mutex);
+            closed = true;
+            changed.notify_all();
+        }
+
+        // Returns false once the queue is closed and empty
+        bool Pop(Checkpoint& checkpoint) {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return !pending.empty() || closed; });
+
+            if (pending.empty())
+                return false;
+
+            checkpoint = std::move(pending.front());
+            pending.pop_front();
+            changed.notify_all();
+            return true;
+        }
+    };
+}
+
+void IntervalConfig::Validate() const {
+    if (interval == 0)
+        throw std::invalid_argument("Interval must not be empty");
+}
+
+uint64_t IntervalReport::Instructions() const {
+    uint64_t total = 0;
+
+    for (const Interval& i : intervals)
+        total += i.instructions;
+
+    return total;
+}
+
+uint64_t IntervalReport::Cycles() const {
+    uint64_t total = 0;
+
+    for (const Interval& i : intervals)
+        total += i.cycles;
+
+    return total;
+}
+
+void IntervalReport::Print(std::FILE* out) const {
+    const uint64_t instructions = Instructions();
+    const uint64_t cycles = Cycles();
+    double minCPI = 0;
+    double maxCPI = 0;
+
+    for (std::size_t i = 0; i < intervals.size(); i++) {
+        const double cpi = static_cast<double>(intervals[i].cycles) / static_cast<double>(std::max<uint64_t>(1, intervals[i].instructions));
+
+        minCPI = i == 0 ? cpi : std::min(minCPI, cpi);
+        maxCPI = i == 0 ? cpi : std::max(maxCPI, cpi);
+    }
+
+    fprintf(out, "Interval-parallel simulation\n");
+    fprintf(out, "\tIntervals:    %zu on %u threads, %.3f s\n", intervals.size(), threads, seconds);
+    fprintf(out, "\tInstructions: %llu\n", static_cast<unsigned long long>(instructions));
+    fprintf(out, "\tCycles:       %llu\n", static_cast<unsigned long long>(cycles));
+    fprintf(
+        out, "\tCPI:          %.4f (intervals %.4f to %.4f)\n"
+        , instructions == 0 ? 0.0 : static_cast<double>(cycles) / static_cast<double>(instructions), minCPI, maxCPI
+    );
+    fprintf(
+        out, "\tIdle stage calls skipped: %llu of %llu\n"
+        , static_cast<unsigned long long>(stageSkips), static_cast<unsigned long long>(stageCalls)
+    );
+}
+
+IntervalReport SPIMDF::RunIntervals(CPU& cpu, const IntervalConfig& config) {
+    config.Validate();
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const unsigned threads = ResolveThreads(config.threads);
+    const CPU initial = cpu; // Program and pipeline geometry for the workers
+
+    IntervalReport report;
+    report.threads = threads;
+
+    CheckpointQueue queue(4 * std::size_t{ threads });
+    std::mutex reportMutex;
+
+    // The newest delta. It starts as an empty head for the workers to start from; after that only the workers
+    // hold the older ones, each from where it has got to, so deltas every worker is past are freed.
+    std::shared_ptr<MemoryDelta> last = std::make_shared<MemoryDelta>();
+
+    const auto work = [&](std::shared_ptr<MemoryDelta> applied) {
+        CPU worker = initial;
+        const FetchExec& fetch = worker.executors.fetch;
+        Checkpoint checkpoint;
+
+        // Memory as of the last checkpoint applied, and the words this worker's own run has written since.
+        // Undoing those and applying the deltas brings the worker's memory to the next checkpoint without
+        // copying all of it.
+        std::map<uint32_t, int32_t> base = initial.GetAllMem();
+        std::vector<uint32_t> written;
+        worker.SetStoreLog(&written);
+
+        while (queue.Pop(checkpoint)) {
+            for (const uint32_t addr : written) {
+                const auto it = base.find(addr);
+                worker.Mem(addr) = it != base.end() ? it->second : 0;
+            }
+
+            written.clear();
+
+            while (applied != checkpoint.delta) {
+                applied = applied->next;
+
+                for (const auto& [addr, value] : applied->writes) {
+                    base[addr] = value;
+                    worker.Mem(addr) = value;
+                }
+            }
+
+            worker.SetRegisterState(checkpoint.pc, checkpoint.registers);
+
+            while (fetch.fetched < checkpoint.warmup && !fetch.isBroken)
+                worker.Clock();
+
+            const uint64_t startCycle = worker.GetCycle();
+            const uint64_t startCalls = worker.GetStageCalls();
+            const uint64_t startSkips = worker.GetStageSkips();
+
+            // The last interval ends at BREAK, like a full run
+            while (fetch.fetched < checkpoint.warmup + config.interval && !fetch.isBroken)
+                worker.Clock();
+
+            // Fetch can overshoot the end by a few instructions, which belong to the next interval
+            const uint64_t length = std::min(fetch.fetched - std::min(fetch.fetched, checkpoint.warmup), config.interval);
+
+            std::lock_guard lock(reportMutex);
+
+            if (report.intervals.size() <= checkpoint.index)
+                report.intervals.resize(checkpoint.index + 1);
+
+            report.intervals[checkpoint.index] = { length, worker.GetCycle() - startCycle };
+            report.stageCalls += worker.GetStageCalls() - startCalls;
+            report.stageSkips += worker.GetStageSkips() - startSkips;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back(work, last);
+
+    // Each interval's checkpoint is taken warmup instructions before it starts. The workers find where the
+    // last interval ends, at BREAK.
+    FunctionalEngine engine(cpu);
+    std::vector<uint32_t> written; // Since the last checkpoint
+
+    if (config.useJit)
+        engine.EnableJit();
+
+    cpu.SetStoreLog(&written);
+
+    for (std::size_t index = 0; ; index++) {
+        const uint64_t start = index * config.interval;
+        const uint64_t checkpointAt = start > config.warmup ? start - config.warmup : 0;
+
+        engine.Run(checkpointAt - engine.GetRetired());
+
+        if (engine.IsHalted())
+            break;
+
+        std::sort(written.begin(), written.end());
+        written.erase(std::unique(written.begin(), written.end()), written.end());
+
+        auto delta = std::make_shared<MemoryDelta>();
+        delta->writes.reserve(written.size());
+
+        for (const uint32_t addr : written)
+            delta->writes.emplace_back(addr, cpu.Mem(addr));
+
+        written.clear();
+        last->next = delta;
+        last = delta;
+
+        Checkpoint checkpoint{ index, start - checkpointAt, cpu.GetPC(), {}, std::move(delta) };
+
+        for (uint8_t r = 0; r < 32; r++)
+            checkpoint.registers[r] = cpu.Reg(r);
+
+        queue.Push(std::move(checkpoint));
+    }
+
+    cpu.SetStoreLog(nullptr);
+    queue.Close();
+
+    for (auto& worker : workers)
+        worker.join();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return report;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace SPIMDF {
+    class CPU;
+
+    // Detailed simulation split across threads. The functional engine runs the program once and leaves an
+    // ArchState checkpoint at every interval boundary (less the warm-up); worker threads pick the checkpoints
+    // up as they appear and each runs one interval in its own copy of the pipeline. Interval cycle counts add
+    // up to the run's. The only error is at the boundaries, where each interval starts from a pipeline
+    // refilled by warmup instructions rather than the real one.
+    struct IntervalConfig {
+        uint64_t interval = 1000000; // Instructions
+        uint64_t warmup = 100;       // Run in the pipeline before each interval but not counted
+        unsigned threads = 0;        // Workers; 0 for one per hardware thread
+        bool useJit = false;
+
+        // Throws std::invalid_argument if interval is zero
+        void Validate() const;
+    };
+
+    struct IntervalReport {
+        struct Interval {
+            uint64_t instructions = 0;
+            uint64_t cycles = 0;
+        };
+
+        std::vector<Interval> intervals;
+        uint64_t stageCalls = 0; // Summed over the measured parts of every interval
+        uint64_t stageSkips = 0;
+        unsigned threads = 0;
+        double seconds = 0;
+
+        uint64_t Instructions() const;
+        uint64_t Cycles() const;
+
+        void Print(std::FILE* out) const;
+    };
+
+    // Runs the program loaded in cpu from its current PC to BREAK. The CPU must not have started clocking.
+    IntervalReport RunIntervals(CPU& cpu, const IntervalConfig& config);
+}
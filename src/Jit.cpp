@@ -0,0 +1,230 @@
+#include "Jit.hpp"
+#include "CPU.hpp"
+#include "ISA.hpp"
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if SPIMDF_JIT
+    #include <sys/mman.h>
+#endif
+
+using namespace SPIMDF;
+
+#if SPIMDF_JIT
+
+namespace {
+    // Memory goes through the CPU's store, exactly as MemExec does
+    int32_t LoadWord(CPU* cpu, uint32_t addr) noexcept {
+        return cpu->Mem(addr);
+    }
+
+    void StoreWord(CPU* cpu, uint32_t addr, int32_t value) noexcept {
+        cpu->Store(addr, value);
+    }
+
+    // Just the encodings the translator needs. rbx holds the register file and r12 the CPU for the whole block.
+    class Emitter {
+        std::vector<uint8_t> code;
+
+        public:
+        // 32-bit host registers by encoding
+        enum Host : uint8_t { EAX = 0, ECX = 1, EDX = 2, ESI = 6 };
+
+        void Bytes(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); };
+
+        void Imm32(uint32_t value) {
+            for (int i = 0; i < 4; i++)
+                code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+
+        void Imm64(uint64_t value) {
+            for (int i = 0; i < 8; i++)
+                code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+
+        // mov host, [rbx + 4 * guest]
+        void LoadReg(Host host, uint8_t guest) { Bytes({ 0x8B, static_cast<uint8_t>(0x43 | (host << 3)), static_cast<uint8_t>(4 * guest) }); };
+
+        // mov [rbx + 4 * guest], eax
+        void StoreEAX(uint8_t guest) { Bytes({ 0x89, 0x43, static_cast<uint8_t>(4 * guest) }); };
+
+        // mov host, imm32
+        void MovImm(Host host, uint32_t value) { Bytes({ static_cast<uint8_t>(0xB8 + host) }); Imm32(value); };
+
+        // mov rdi, r12; mov rax, fn; call rax
+        void CallWithCPU(const void* fn) {
+            Bytes({ 0x4C, 0x89, 0xE7, 0x48, 0xB8 });
+            Imm64(reinterpret_cast<uint64_t>(fn));
+            Bytes({ 0xFF, 0xD0 });
+        }
+
+        void Prologue() {
+            Bytes({ 0x53, 0x41, 0x54 });       // push rbx; push r12
+            Bytes({ 0x48, 0x83, 0xEC, 0x08 }); // sub rsp, 8 (align calls to 16)
+            Bytes({ 0x48, 0x89, 0xFB });       // mov rbx, rdi
+            Bytes({ 0x49, 0x89, 0xF4 });       // mov r12, rsi
+        }
+
+        void Epilogue() {
+            Bytes({ 0x48, 0x83, 0xC4, 0x08 }); // add rsp, 8
+            Bytes({ 0x41, 0x5C, 0x5B, 0xC3 }); // pop r12; pop rbx; ret
+        }
+
+        const std::vector<uint8_t>& Code() const { return code; };
+    };
+
+    // Emits one non-terminating instruction. Matches Executors:: and the writeback/memory stages bit for bit.
+    void EmitOp(Emitter& e, const Block::Op& op) {
+        using Host = Emitter::Host;
+
+        const auto binary = [&](std::initializer_list<uint8_t> opEAXECX) { // eax = b op c
+            e.LoadReg(Host::EAX, op.b);
+            e.LoadReg(Host::ECX, op.c);
+            e.Bytes(opEAXECX);
+            e.StoreEAX(op.a);
+        };
+
+        const auto immediate = [&](uint8_t opEAXImm32) { // eax = b op imm
+            e.LoadReg(Host::EAX, op.b);
+            e.Bytes({ opEAXImm32 });
+            e.Imm32(static_cast<uint32_t>(op.imm)); // The executors' static_cast<uint32_t> keeps the sign extension
+            e.StoreEAX(op.a);
+        };
+
+        const auto shift = [&](uint8_t modrm) { // eax = c shift sa
+            e.LoadReg(Host::EAX, op.c);
+            e.Bytes({ 0xC1, modrm, static_cast<uint8_t>(op.imm) });
+            e.StoreEAX(op.a);
+        };
+
+        switch (op.opcode) {
+            case ISA::Opcode::ADD:  binary({ 0x01, 0xC8 }); break;                         // add eax, ecx
+            case ISA::Opcode::SUB:  binary({ 0x29, 0xC8 }); break;                         // sub eax, ecx
+            case ISA::Opcode::MUL:  binary({ 0x0F, 0xAF, 0xC1 }); break;                   // imul eax, ecx
+            case ISA::Opcode::AND:  binary({ 0x21, 0xC8 }); break;                         // and eax, ecx
+            case ISA::Opcode::OR:   binary({ 0x09, 0xC8 }); break;                         // or eax, ecx
+            case ISA::Opcode::XOR:  binary({ 0x31, 0xC8 }); break;                         // xor eax, ecx
+            case ISA::Opcode::NOR:  binary({ 0x09, 0xC8, 0xF7, 0xD0 }); break;             // or eax, ecx; not eax
+            case ISA::Opcode::SLT:  binary({ 0x39, 0xC8, 0x0F, 0x9C, 0xC0, 0x0F, 0xB6, 0xC0 }); break; // cmp; setl al; movzx eax, al
+            case ISA::Opcode::ADDI: immediate(0x05); break;                                // add eax, imm32
+            case ISA::Opcode::ANDI: immediate(0x25); break;                                // and eax, imm32
+            case ISA::Opcode::ORI:  immediate(0x0D); break;                                // or eax, imm32
+            case ISA::Opcode::XORI: immediate(0x35); break;                                // xor eax, imm32
+            case ISA::Opcode::SLL:  shift(0xE0); break;                                    // shl eax, sa
+            case ISA::Opcode::SRL:  shift(0xE8); break;                                    // shr eax, sa (logical)
+            case ISA::Opcode::SRA:  shift(0xF8); break;                                    // sar eax, sa
+            case ISA::Opcode::LW:
+                e.LoadReg(Host::ESI, op.b);
+                e.Bytes({ 0x81, 0xC6 }); // add esi, imm32
+                e.Imm32(static_cast<uint32_t>(op.imm));
+                e.CallWithCPU(reinterpret_cast<const void*>(&LoadWord));
+                e.StoreEAX(op.a);
+                break;
+            case ISA::Opcode::SW:
+                e.LoadReg(Host::ESI, op.b);
+                e.Bytes({ 0x81, 0xC6 });
+                e.Imm32(static_cast<uint32_t>(op.imm));
+                e.LoadReg(Host::EDX, op.a);
+                e.CallWithCPU(reinterpret_cast<const void*>(&StoreWord));
+                break;
+            default: // NOP
+                break;
+        }
+    }
+
+    // Leaves the next PC in eax
+    void EmitTerminator(Emitter& e, const Block& block, const Block::Op& last, bool cut) {
+        using Host = Emitter::Host;
+
+        if (cut) {
+            e.MovImm(Host::EAX, block.fallthrough);
+            return;
+        }
+
+        switch (last.opcode) {
+            case ISA::Opcode::J:
+                e.MovImm(Host::EAX, block.target);
+                break;
+            case ISA::Opcode::JR:
+                e.LoadReg(Host::EAX, last.b);
+                break;
+            case ISA::Opcode::BEQ:
+                e.LoadReg(Host::EAX, last.b);
+                e.Bytes({ 0x3B, 0x43, static_cast<uint8_t>(4 * last.a) }); // cmp eax, [rbx + 4 * rt]
+                e.MovImm(Host::EAX, block.fallthrough);
+                e.MovImm(Host::ECX, block.target);
+                e.Bytes({ 0x0F, 0x44, 0xC1 }); // cmove eax, ecx
+                break;
+            default: // BLTZ, BGTZ
+                e.LoadReg(Host::ECX, last.b);
+                e.MovImm(Host::EAX, block.fallthrough);
+                e.MovImm(Host::EDX, block.target);
+                e.Bytes({ 0x85, 0xC9 }); // test ecx, ecx
+                e.Bytes({ 0x0F, static_cast<uint8_t>(last.opcode == ISA::Opcode::BLTZ ? 0x4C : 0x4F), 0xC2 }); // cmovl / cmovg eax, edx
+                break;
+        }
+    }
+}
+
+JitCompiler::JitCompiler(std::size_t capacity) {
+    void* mapped = mmap(nullptr, capacity, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapped != MAP_FAILED) {
+        buffer = static_cast<unsigned char*>(mapped);
+        this->capacity = capacity;
+    }
+}
+
+JitCompiler::~JitCompiler() {
+    if (buffer != nullptr)
+        munmap(buffer, capacity);
+}
+
+Block::NativeCode JitCompiler::Compile(const Block& block) {
+    const bool cut = block.ops.size() > block.length; // Ends in EndOfBlock rather than a jump
+    const Block::Op& last = block.ops[block.length - 1];
+
+    if (!cut && last.opcode == ISA::Opcode::BRK)
+        return nullptr;
+
+    Emitter e;
+    e.Prologue();
+
+    for (std::size_t i = 0; i + (cut ? 0 : 1) < block.length; i++)
+        EmitOp(e, block.ops[i]);
+
+    EmitTerminator(e, block, last, cut);
+    e.Epilogue();
+
+    const std::vector<uint8_t>& code = e.Code();
+    const std::size_t size = (code.size() + 15) & ~std::size_t{ 15 };
+
+    if (buffer == nullptr || size > capacity - used)
+        return nullptr;
+
+    // Flip the whole buffer to writable while copying in; code already handed out is not running meanwhile
+    unsigned char* entry = buffer + used;
+
+    if (mprotect(buffer, capacity, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+
+    std::memcpy(entry, code.data(), code.size());
+    used += size;
+
+    if (mprotect(buffer, capacity, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+
+    return reinterpret_cast<Block::NativeCode>(entry);
+}
+
+#else
+
+JitCompiler::JitCompiler(std::size_t) { }
+JitCompiler::~JitCompiler() { }
+
+Block::NativeCode JitCompiler::Compile(const Block&) {
+    return nullptr;
+}
+
+#endif
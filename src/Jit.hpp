@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BlockCache.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__linux__)
+    #define SPIMDF_JIT 1
+#else
+    #define SPIMDF_JIT 0
+#endif
+
+namespace SPIMDF {
+    class CPU;
+
+    // Translates blocks to x86-64 code in an mmap'd buffer that is writable or executable, never both.
+    // Guest registers stay in the CPU's register file, addressed off a pinned host register; LW and SW call
+    // back into CPU::Mem(). Only available on Linux x86-64. Elsewhere, or once the buffer is full, Compile()
+    // returns nullptr and the caller keeps interpreting the block.
+    class JitCompiler {
+        unsigned char* buffer = nullptr;
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+
+        public:
+        static constexpr bool Available = SPIMDF_JIT;
+
+        explicit JitCompiler(std::size_t capacity = std::size_t{ 4 } << 20);
+        ~JitCompiler();
+
+        JitCompiler(const JitCompiler&) = delete;
+        JitCompiler& operator=(const JitCompiler&) = delete;
+
+        // Returns nullptr for blocks ending in BREAK, which leave the engine and so are not worth compiling
+        Block::NativeCode Compile(const Block& block);
+
+        // Discards every compiled block. Call when the blocks they came from are flushed.
+        void Reset() { used = 0; };
+
+        std::size_t BytesUsed() const { return used; };
+    };
+}
@@ -0,0 +1,75 @@
+#include "Loader.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SPIMDF_HAS_MMAP 1
+#endif
+
+using namespace SPIMDF;
+
+MappedFile::MappedFile(const char* filename) {
+#ifdef SPIMDF_HAS_MMAP
+    const int fd = open(filename, O_RDONLY);
+
+    if (fd >= 0) {
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+                data = static_cast<const char*>(mapping);
+                size = st.st_size;
+                isMapped = true;
+            }
+        }
+
+        close(fd);
+
+        if (isMapped)
+            return;
+    }
+#endif
+
+    // Fall back to reading the whole file (also covers empty files, which cannot be mapped)
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file.is_open())
+        return;
+
+    fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = fallback.data();
+    size = fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef SPIMDF_HAS_MMAP
+    if (isMapped)
+        munmap(const_cast<char*>(data), size);
+#endif
+}
+
+void SPIMDF::detail::MalformedWord(const char* token, const char* end) {
+    constexpr std::size_t MaxShown = 40;
+    std::size_t length = 0;
+
+    while (token + length != end && !IsSpace(token[length]))
+        length++;
+
+    std::string shown(token, std::min(length, MaxShown));
+
+    if (length > MaxShown)
+        shown += "...";
+
+    throw std::runtime_error("Expected a 32-character binary machine word, got \"" + shown + "\"");
+}
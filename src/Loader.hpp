@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace SPIMDF {
+    // Read-only view of an entire file. Memory-mapped where the platform supports it,
+    // otherwise read into an owned buffer.
+    class MappedFile {
+        const char* data = nullptr;
+        std::size_t size = 0;
+        bool isMapped = false;
+        std::string fallback;
+
+        public:
+        explicit MappedFile(const char* filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool IsOpen() const { return data != nullptr; };
+        std::string_view View() const { return std::string_view(data, size); };
+    };
+
+    namespace detail {
+        constexpr uint32_t BitReverse(uint32_t x) {
+            x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+            x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+            x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+            x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+            return (x >> 16) | (x << 16);
+        }
+
+        constexpr bool IsSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+        }
+
+        // Throws std::runtime_error naming the token that starts at token
+        [[noreturn]] void MalformedWord(const char* token, const char* end);
+    }
+
+    // True if all 32 characters at bits are ASCII '0' or '1'
+    inline bool IsMachineWord(const char* bits) {
+        // '0' and '1' differ only in the low bit, so setting it must give '1'
+    #if defined(__AVX2__)
+        const __m256i chars = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits)), _mm256_set1_epi8(1));
+
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('1'))) == -1;
+    #elif defined(__SSE2__)
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i ones = _mm_set1_epi8('1');
+        const __m128i lo = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bits)), one);
+        const __m128i hi = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bits + 16)), one);
+
+        return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(lo, ones), _mm_cmpeq_epi8(hi, ones))) == 0xFFFF;
+    #else
+        for (std::size_t i = 0; i < 32; i++) {
+            if ((bits[i] | 1) != '1')
+                return false;
+        }
+
+        return true;
+    #endif
+    }
+
+    // Packs exactly 32 ASCII '0'/'1' characters into a machine word. The first character becomes bit 31.
+    inline uint32_t PackMachineWord(const char* bits) {
+    #if defined(__AVX2__)
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits));
+
+        // Reverse the bytes within each lane, then swap lanes, so the first character lands in the movemask MSB
+        const __m256i reverse = _mm256_setr_epi8(
+              15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+            , 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+        );
+        const __m256i reversed = _mm256_shuffle_epi8(chars, reverse);
+        const __m256i swapped = _mm256_permute2x128_si256(reversed, reversed, 0x01);
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(swapped, _mm256_set1_epi8('1'))));
+    #elif defined(__SSE2__)
+        const __m128i ones = _mm_set1_epi8('1');
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits + 16));
+
+        // Bit i of the mask is character i, so reverse it to put the first character in bit 31
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lo, ones)))
+                            | static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(hi, ones))) << 16;
+
+        return detail::BitReverse(mask);
+    #else
+        uint32_t word = 0;
+
+        for (std::size_t i = 0; i < 32; i++)
+            word = (word << 1) | static_cast<uint32_t>(bits[i] == '1');
+
+        return word;
+    #endif
+    }
+
+    // Calls func(word, chars) for every whitespace separated 32-character word in text, in order.
+    // Stops early if func returns false. Throws std::runtime_error on any other token, a trailing partial
+    // word included.
+    template<typename Func>
+    void ForEachMachineWord(std::string_view text, Func&& func) {
+        const char* cur = text.data();
+        const char* const end = cur + text.size();
+
+        while (true) {
+            while (cur != end && detail::IsSpace(*cur))
+                cur++;
+
+            if (cur == end)
+                return;
+
+            if (end - cur < 32 || !IsMachineWord(cur) || (end - cur > 32 && !detail::IsSpace(cur[32])))
+                detail::MalformedWord(cur, end);
+
+            const std::string_view chars(cur, 32);
+
+            if (!func(PackMachineWord(cur), chars))
+                return;
+
+            cur += 32;
+        }
+    }
+}
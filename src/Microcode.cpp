@@ -2,26 +2,28 @@
 #include "CPU.hpp"
 #include <cstdio>
 #include "Instruction.hpp"
-#include <sstream>
+#include <charconv>
 
 using namespace SPIMDF;
 
-#define EX_FUNC(X) void Executors::X(CPU& cpu, const Instruction& in,  const std::function<void(int32_t)>& resultCB)
-#define PR_FUNC(X) std::string Printers::X(const Instruction& in)
+#define EX_FUNC(X) int32_t Executors::X(CPU& cpu, const Instruction& in)
+#define PR_FUNC(X) char* Printers::X(const Instruction& in, char* out)
 
-#define EX_NULL(X) EX_FUNC(X) { printf(#X " executor undefined"); }
-#define PR_NULL(X) PR_FUNC(X) { return std::string(#X " printer undefined"); }
+#define EX_NULL(X) EX_FUNC(X) { printf(#X " executor undefined"); return 0; }
+#define PR_NULL(X) PR_FUNC(X) { return Put(out, #X " printer undefined"); }
 
 // Category 1
 
 EX_FUNC(J) {
     const ISA::JType& format = in.GetFormat<ISA::JType>();
     cpu.Jump((cpu.GetPC() & 0xF0000000) | (format.index << 2));
+    return 0;
 }
  
 EX_FUNC(JR) {
     const auto& format = in.GetFormat<ISA::RType>();
     cpu.Jump(cpu.Reg(format.rs));
+    return 0;
 }
 
 EX_FUNC(BEQ) {
@@ -29,6 +31,8 @@ EX_FUNC(BEQ) {
 
     if (cpu.Reg(format.rs) == cpu.Reg(format.rt))
         cpu.Jump(cpu.GetPC() + (format.imm * 4));
+
+    return 0;
 }
 
 EX_FUNC(BLTZ) {
@@ -36,6 +40,8 @@ EX_FUNC(BLTZ) {
 
     if (cpu.Reg(format.rs) < 0)
         cpu.Jump(cpu.GetPC() + (format.imm * 4));
+
+    return 0;
 }
 
 EX_FUNC(BGTZ) {
@@ -43,233 +49,229 @@ EX_FUNC(BGTZ) {
 
     if (cpu.Reg(format.rs) > 0)
         cpu.Jump(cpu.GetPC() + (format.imm * 4));
+
+    return 0;
 }
 
 EX_FUNC(SW) {
     const auto& format = in.GetFormat<ISA::IType>();
     // cpu.Mem(cpu.Reg(format.rs) + format.imm) = cpu.Reg(format.rt);
-    resultCB((int32_t) (cpu.Reg(format.rs) + format.imm)); // Calculate address
+    return (int32_t) (cpu.Reg(format.rs) + format.imm); // Calculate address
 }
 
 EX_FUNC(LW) {
     const auto& format = in.GetFormat<ISA::IType>();
     // cpu.Reg(format.rt) = cpu.Mem(cpu.Reg(format.rs) + format.imm);
-    resultCB((int32_t) (cpu.Reg(format.rs) + format.imm)); // Calculate address
+    return (int32_t) (cpu.Reg(format.rs) + format.imm); // Calculate address
 }
 
 EX_FUNC(SLL) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rt) << format.sa);
+    return cpu.Reg(format.rt) << format.sa;
 }
 
 EX_FUNC(SRL) {
     const auto& format = in.GetFormat<ISA::RType>();
     // Cast to unsigned int to do guarantee logical shift, then shift by shamt
-    resultCB(static_cast<int32_t>(static_cast<uint32_t>(cpu.Reg(format.rt)) >> format.sa));
+    return static_cast<int32_t>(static_cast<uint32_t>(cpu.Reg(format.rt)) >> format.sa);
 }
 
 EX_FUNC(SRA) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rt) >> format.sa);
+    return cpu.Reg(format.rt) >> format.sa;
 }
 
-EX_FUNC(NOP) { }
+EX_FUNC(NOP) { return 0; }
 
-EX_FUNC(BRK) { }
+EX_FUNC(BRK) { return 0; }
 
 // Category 2
 EX_FUNC(ADD) {
     const auto& format = in.GetFormat<ISA::RType>();
     // cpu.Reg(format.rd) = cpu.Reg(format.rs) + cpu.Reg(format.rt);
-    resultCB(cpu.Reg(format.rs) + cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) + cpu.Reg(format.rt);
 }
 
 EX_FUNC(SUB) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) - cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) - cpu.Reg(format.rt);
 }
 
 EX_FUNC(MUL) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) * cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) * cpu.Reg(format.rt);
 }
 
 EX_FUNC(AND) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) & cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) & cpu.Reg(format.rt);
 }
 
 EX_FUNC(OR) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) | cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) | cpu.Reg(format.rt);
 } 
 
 EX_FUNC(XOR) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) ^ cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) ^ cpu.Reg(format.rt);
 }
 
 EX_FUNC(NOR) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB( ~(cpu.Reg(format.rs) | cpu.Reg(format.rt)) );
+    return  ~(cpu.Reg(format.rs) | cpu.Reg(format.rt)) ;
 }
 
 EX_FUNC(SLT) {
     const auto& format = in.GetFormat<ISA::RType>();
-    resultCB(cpu.Reg(format.rs) < cpu.Reg(format.rt));
+    return cpu.Reg(format.rs) < cpu.Reg(format.rt);
 }
 
 EX_FUNC(ADDI) {
     const auto& format = in.GetFormat<ISA::IType>();
     // cpu.Reg(format.rt) = cpu.Reg(format.rs) + format.imm;
-    resultCB(cpu.Reg(format.rs) + format.imm);
+    return cpu.Reg(format.rs) + format.imm;
 }
 
 EX_FUNC(ANDI) {
     const auto& format = in.GetFormat<ISA::IType>();
-    resultCB(cpu.Reg(format.rs) & static_cast<uint32_t>(format.imm)); // Zero extend immediate
+    return cpu.Reg(format.rs) & static_cast<uint32_t>(format.imm); // Zero extend immediate
 }
 
 EX_FUNC(ORI) {
     const auto& format = in.GetFormat<ISA::IType>();
-    resultCB(cpu.Reg(format.rs) | static_cast<uint32_t>(format.imm)); // Zero extend immediate
+    return cpu.Reg(format.rs) | static_cast<uint32_t>(format.imm); // Zero extend immediate
 }
 
 EX_FUNC(XORI) {
     const auto& format = in.GetFormat<ISA::IType>();
-    resultCB(cpu.Reg(format.rs) ^ static_cast<uint32_t>(format.imm)); // Zero extend immediate
+    return cpu.Reg(format.rs) ^ static_cast<uint32_t>(format.imm); // Zero extend immediate
 }
 
-std::string String_RType(const char* opcode, const ISA::RType& format) {
-    std::ostringstream ss;
+// Allocation-free formatting helpers. Each returns the new end of the output.
+namespace {
+    char* Put(char* out, const char* str) {
+        while (*str != '\0')
+            *out++ = *str++;
 
-    ss << opcode
-       << " R" << +format.rd
-       << ", R" << +format.rs
-       << ", R" << +format.rt;
+        return out;
+    }
 
-    return ss.str();
-}
+    char* Put(char* out, int32_t value) {
+        return std::to_chars(out, out + 11, value).ptr;
+    }
 
-std::string String_IType(const char* opcode, const ISA::IType& format, int mult = 1) {
-    std::ostringstream ss;
+    char* PutReg(char* out, const char* prefix, uint8_t reg) {
+        return Put(Put(out, prefix), reg);
+    }
+}
 
-    ss << opcode
-       << " R" << +format.rt
-       << ", R" << +format.rs
-       << ", #" << (format.imm * mult);
+char* String_RType(char* out, const char* opcode, const ISA::RType& format) {
+    out = Put(out, opcode);
+    out = PutReg(out, " R", format.rd);
+    out = PutReg(out, ", R", format.rs);
+    return PutReg(out, ", R", format.rt);
+}
 
-    return ss.str();
+char* String_IType(char* out, const char* opcode, const ISA::IType& format, int mult = 1) {
+    out = Put(out, opcode);
+    out = PutReg(out, " R", format.rt);
+    out = PutReg(out, ", R", format.rs);
+    return Put(Put(out, ", #"), format.imm * mult);
 }
 
 PR_FUNC(J) {
     const ISA::JType& format = in.GetFormat<ISA::JType>();
 
-    std::stringstream ss;
-    ss << "J #" << (format.index << 2);
-
-    return ss.str();
+    return Put(Put(out, "J #"), format.index << 2);
 }
 
 // Category 1
 PR_FUNC(JR) {
     const ISA::RType& format = in.GetFormat<ISA::RType>();
-    
-    std::stringstream ss;
-    ss << "JR R" << +format.rs;
 
-    return ss.str();
+    return PutReg(out, "JR R", format.rs);
 }
 
 PR_FUNC(BEQ) {
     const ISA::IType& format = in.GetFormat<ISA::IType>();
 
-    std::stringstream ss;
-    ss << "BEQ R" << + format.rs << ", R" << +format.rt << ", #" << (format.imm * 4);
-
-    return ss.str();
+    out = PutReg(out, "BEQ R", format.rs);
+    out = PutReg(out, ", R", format.rt);
+    return Put(Put(out, ", #"), format.imm * 4);
 }
 
 PR_FUNC(BLTZ) {
     const ISA::IType& format = in.GetFormat<ISA::IType>();
-    
-    std::stringstream ss;
-    ss << "BLTZ R" << +format.rs << ", #" << (format.imm * 4);
 
-    return ss.str();
+    out = PutReg(out, "BLTZ R", format.rs);
+    return Put(Put(out, ", #"), format.imm * 4);
 }
 
 PR_FUNC(BGTZ) {
     const ISA::IType& format = in.GetFormat<ISA::IType>();
-    
-    std::stringstream ss;
-    ss << "BGTZ R" << +format.rs << ", #" << (format.imm * 4);
 
-    return ss.str();
+    out = PutReg(out, "BGTZ R", format.rs);
+    return Put(Put(out, ", #"), format.imm * 4);
 }
 
 PR_FUNC(SW) {
     const ISA::IType& format = in.GetFormat<ISA::IType>();
 
-    std::stringstream ss;
-    ss << "SW R" << +format.rt << ", " << format.imm << "(R" << +format.rs << ")";
-
-    return ss.str();
+    out = PutReg(out, "SW R", format.rt);
+    out = Put(Put(out, ", "), format.imm);
+    return Put(PutReg(out, "(R", format.rs), ")");
 }
 
 PR_FUNC(LW) {
     const ISA::IType& format = in.GetFormat<ISA::IType>();
 
-    std::stringstream ss;
-    ss << "LW R" << +format.rt << ", " << format.imm << "(R" << +format.rs  << ")";
-
-    return ss.str();
+    out = PutReg(out, "LW R", format.rt);
+    out = Put(Put(out, ", "), format.imm);
+    return Put(PutReg(out, "(R", format.rs), ")");
 }
 
 PR_FUNC(SLL) {
     const ISA::RType& format = in.GetFormat<ISA::RType>();
 
-    std::stringstream ss;
-    ss << "SLL R" << +format.rd << ", R" << +format.rt << ", #"  << +format.sa;
-
-    return ss.str();
+    out = PutReg(out, "SLL R", format.rd);
+    out = PutReg(out, ", R", format.rt);
+    return Put(Put(out, ", #"), format.sa);
 }
 
 PR_FUNC(SRL) {
     const ISA::RType& format = in.GetFormat<ISA::RType>();
 
-    std::stringstream ss;
-    ss << "SRL R" << +format.rd << ", R" << +format.rt << ", #"  << +format.sa;
-
-    return ss.str();
+    out = PutReg(out, "SRL R", format.rd);
+    out = PutReg(out, ", R", format.rt);
+    return Put(Put(out, ", #"), format.sa);
 }
 
 PR_FUNC(SRA) {
     const ISA::RType& format = in.GetFormat<ISA::RType>();
 
-    std::stringstream ss;
-    ss << "SRA R" << +format.rd << ", R" << +format.rt << ", #"  << +format.sa;
-
-    return ss.str();
+    out = PutReg(out, "SRA R", format.rd);
+    out = PutReg(out, ", R", format.rt);
+    return Put(Put(out, ", #"), format.sa);
 }
 
 PR_FUNC(NOP) {
-    return "NOP";
+    return Put(out, "NOP");
 }
 
 PR_FUNC(BRK) {
-    return "BREAK";
+    return Put(out, "BREAK");
 }
 
 // Category 2
 #define PR_CAT2_RTYPE(X) PR_FUNC(X) { \
     const ISA::RType& format = in.GetFormat<ISA::RType>(); \
-    return String_RType(#X, format); \
+    return String_RType(out, #X, format); \
 }
 
 #define PR_CAT2_ITYPE(X) PR_FUNC(X) { \
     const ISA::IType& format = in.GetFormat<ISA::IType>(); \
-    return String_IType(#X, format); \
+    return String_IType(out, #X, format); \
 }
 
 PR_CAT2_RTYPE(ADD)
@@ -1,15 +1,17 @@
 #pragma once
 
-#include <functional>
-#include <optional>
-#include <string>
+#include "ISA.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace SPIMDF {
     class Instruction;
     class CPU;
 
-    #define DEF_EX(X) void X(CPU& cpu, const Instruction& instr, const std::function<void(int32_t)>&);
-    #define DEF_PR(X) std::string X(const Instruction& instr);
+    // Executors return the instruction's result (ALU value or memory address), or 0 if it has none
+    #define DEF_EX(X) int32_t X(CPU& cpu, const Instruction& instr);
+    #define DEF_PR(X) char* X(const Instruction& instr, char* out);
 
     namespace Executors {
         // Category 1
@@ -40,7 +42,11 @@ namespace SPIMDF {
         DEF_EX(XORI);
     }
 
+    // Printers write the instruction's assembly into out (at most MaxLength characters, not terminated)
+    // and return the end of what they wrote
     namespace Printers {
+        inline constexpr std::size_t MaxLength = 64;
+
         // Category 1
         DEF_PR(J);
         DEF_PR(JR);
@@ -71,4 +77,45 @@ namespace SPIMDF {
 
     #undef DEF_EX
     #undef DEF_PR
+
+    using Executor_t = int32_t(CPU& cpu, const Instruction& instr);
+    using Printer_t = char*(const Instruction& instr, char* out);
+
+    namespace detail {
+        template<typename Fn>
+        constexpr auto MakeOpcodeTable(Fn* (*select)(ISA::Opcode)) {
+            std::array<Fn*, ISA::NumOpcodes> table{};
+
+            for (std::size_t op = 0; op < ISA::NumOpcodes; op++)
+                table[op] = select(static_cast<ISA::Opcode>(op));
+
+            return table;
+        }
+
+        #define SELECT_CASE(NS, X) case ISA::Opcode::X: return &NS::X;
+        #define SELECT_ALL(NS) \
+            SELECT_CASE(NS, J) SELECT_CASE(NS, JR) SELECT_CASE(NS, BEQ) SELECT_CASE(NS, BLTZ) SELECT_CASE(NS, BGTZ) \
+            SELECT_CASE(NS, SW) SELECT_CASE(NS, LW) SELECT_CASE(NS, SLL) SELECT_CASE(NS, SRL) SELECT_CASE(NS, SRA) \
+            SELECT_CASE(NS, NOP) SELECT_CASE(NS, BRK) \
+            SELECT_CASE(NS, ADD) SELECT_CASE(NS, SUB) SELECT_CASE(NS, MUL) SELECT_CASE(NS, AND) SELECT_CASE(NS, OR) \
+            SELECT_CASE(NS, XOR) SELECT_CASE(NS, NOR) SELECT_CASE(NS, SLT) SELECT_CASE(NS, ADDI) SELECT_CASE(NS, ANDI) \
+            SELECT_CASE(NS, ORI) SELECT_CASE(NS, XORI)
+
+        constexpr Executor_t* SelectExecutor(ISA::Opcode opcode) {
+            switch (opcode) { SELECT_ALL(Executors) }
+            return nullptr;
+        }
+
+        constexpr Printer_t* SelectPrinter(ISA::Opcode opcode) {
+            switch (opcode) { SELECT_ALL(Printers) }
+            return nullptr;
+        }
+
+        #undef SELECT_ALL
+        #undef SELECT_CASE
+    }
+
+    // Dispatch tables indexed by ISA::Opcode
+    inline constexpr auto ExecutorTable = detail::MakeOpcodeTable<Executor_t>(detail::SelectExecutor);
+    inline constexpr auto PrinterTable = detail::MakeOpcodeTable<Printer_t>(detail::SelectPrinter);
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace SPIMDF {
+    // Resolves a requested thread count, where 0 means one per hardware thread
+    inline unsigned ResolveThreads(unsigned requested) {
+        if (requested != 0)
+            return requested;
+
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Splits [0, count) into at most `threads` contiguous chunks and calls func(chunk, begin, end) for each
+    // chunk concurrently. The calling thread runs the first chunk. Returns the number of chunks used.
+    // If any chunk throws, the first chunk's exception in chunk order is rethrown once all have finished.
+    template<typename Func>
+    std::size_t ParallelFor(std::size_t count, unsigned threads, Func&& func) {
+        const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(ResolveThreads(threads), count));
+        const std::size_t perChunk = count / chunks;
+        const std::size_t remainder = count % chunks;
+
+        const auto bounds = [&](std::size_t chunk) {
+            return chunk * perChunk + std::min(chunk, remainder); // First `remainder` chunks get one extra
+        };
+
+        std::vector<std::exception_ptr> errors(chunks);
+
+        const auto run = [&](std::size_t chunk) {
+            try {
+                func(chunk, bounds(chunk), bounds(chunk + 1));
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+
+        for (std::size_t chunk = 1; chunk < chunks; chunk++)
+            workers.emplace_back(run, chunk);
+
+        run(0);
+
+        for (auto& worker : workers)
+            worker.join();
+
+        for (const auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        return chunks;
+    }
+}
@@ -0,0 +1,89 @@
+#include "PipelineConfig.hpp"
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace SPIMDF;
+
+namespace {
+    struct Parameter {
+        std::string_view key;
+        unsigned PipelineConfig::* field;
+        unsigned max;
+    };
+
+    constexpr std::array<Parameter, 5> parameters = {{
+          { "pre_issue_depth",   &PipelineConfig::preIssueDepth,  PipelineConfig::MaxPreIssueDepth }
+        , { "pre_alu_depth",     &PipelineConfig::preALUDepth,    PipelineConfig::MaxPreALUDepth }
+        , { "pre_mem_alu_depth", &PipelineConfig::preMemALUDepth, PipelineConfig::MaxPreMemALUDepth }
+        , { "fetch_width",       &PipelineConfig::fetchWidth,     PipelineConfig::MaxFetchWidth }
+        , { "issue_width",       &PipelineConfig::issueWidth,     PipelineConfig::MaxIssueWidth }
+    }};
+
+    std::string_view Trim(std::string_view s) {
+        const auto first = s.find_first_not_of(" \t\r");
+
+        if (first == std::string_view::npos)
+            return {};
+
+        return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+    }
+}
+
+void PipelineConfig::Set(std::string_view assignment) {
+    const auto eq = assignment.find('=');
+
+    if (eq == std::string_view::npos)
+        throw std::invalid_argument("Expected key=value, got \"" + std::string(assignment) + "\"");
+
+    const std::string_view key = Trim(assignment.substr(0, eq));
+    const std::string_view value = Trim(assignment.substr(eq + 1));
+
+    for (const Parameter& p : parameters) {
+        if (p.key != key)
+            continue;
+
+        unsigned parsed = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+
+        if (ec != std::errc() || end != value.data() + value.size() || parsed == 0 || parsed > p.max) {
+            throw std::invalid_argument(
+                "Invalid value for " + std::string(key) + ": \"" + std::string(value) + "\" (1 to " + std::to_string(p.max) + ")"
+            );
+        }
+
+        this->*p.field = parsed;
+        return;
+    }
+
+    throw std::invalid_argument("Unknown pipeline parameter " + std::string(key));
+}
+
+void PipelineConfig::Load(const char* filename) {
+    std::ifstream file(filename);
+
+    if (!file)
+        throw std::runtime_error(std::string("File not found: ") + filename);
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        const std::string_view trimmed = Trim(line);
+
+        if (trimmed.empty() || trimmed.front() == '#')
+            continue;
+
+        Set(trimmed);
+    }
+}
+
+void PipelineConfig::Validate() const {
+    for (const Parameter& p : parameters) {
+        const unsigned value = this->*p.field;
+
+        if (value == 0 || value > p.max)
+            throw std::invalid_argument(std::string(p.key) + " must be between 1 and " + std::to_string(p.max));
+    }
+}
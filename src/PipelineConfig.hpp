@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string_view>
+
+namespace SPIMDF {
+    // Pipeline geometry chosen at run time. Queue storage is sized for the compile-time maxima below,
+    // so changing the geometry never needs a rebuild. The defaults are the original fixed layout.
+    struct PipelineConfig {
+        static constexpr unsigned MaxPreIssueDepth = 64; // One bit per entry in the issue dependency matrix
+        static constexpr unsigned MaxPreALUDepth = 16;
+        static constexpr unsigned MaxPreMemALUDepth = 16;
+        static constexpr unsigned MaxFetchWidth = 8;
+        static constexpr unsigned MaxIssueWidth = 8;
+
+        unsigned preIssueDepth = 4;
+        unsigned preALUDepth = 2;
+        unsigned preMemALUDepth = 2;
+        unsigned fetchWidth = 2;
+        unsigned issueWidth = 2;
+
+        // Issue takes at most this many ALU and memory instructions per cycle. The width is split evenly;
+        // an odd slot goes to the ALU side, except at width 1, where either kind can take the one slot.
+        unsigned IssueWidthALU() const {
+            return (issueWidth + 1) / 2;
+        }
+
+        unsigned IssueWidthMem() const {
+            return issueWidth / 2 > 1 ? issueWidth / 2 : 1;
+        }
+
+        // Sets one parameter from "key=value" (or "key = value"). Keys are the field names in snake case,
+        // e.g. pre_issue_depth. Throws std::invalid_argument on an unknown key or out of range value.
+        void Set(std::string_view assignment);
+
+        // Applies every "key = value" line of a file. Blank lines and lines starting with '#' are ignored.
+        // Throws std::runtime_error if the file cannot be read.
+        void Load(const char* filename);
+
+        // Throws std::invalid_argument if any parameter is zero or above its maximum
+        void Validate() const;
+    };
+}
@@ -0,0 +1,81 @@
+#include "ProgramCache.hpp"
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include "Hash.hpp"
+#include "Image.hpp"
+#include "Loader.hpp"
+#include "Stats.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+using namespace SPIMDF;
+namespace fs = std::filesystem;
+
+namespace {
+    // Publishes a finished file under its final name in one step, so concurrent runs never see a partial entry
+    void Publish(const fs::path& temp, const fs::path& target) {
+        std::error_code ec;
+        fs::rename(temp, target, ec);
+
+        if (ec)
+            fs::remove(temp, ec);
+    }
+
+    fs::path TempPath(const fs::path& target) {
+        std::random_device rd;
+        return fs::path(target.string() + ".tmp" + std::to_string(rd()));
+    }
+}
+
+ProgramCache::ProgramCache(std::string directory) : directory(std::move(directory)) {
+    fs::create_directories(this->directory);
+}
+
+bool ProgramCache::Load(const char* filename, CPU& cpu, RunStats& stats, const char* listingFilename) {
+    MappedFile input(filename);
+
+    if (!input.IsOpen()) {
+        fprintf(stderr, "File not found\n");
+        std::terminate();
+    }
+
+    char key[40];
+    snprintf(key, sizeof(key), "%016llx-%zu", static_cast<unsigned long long>(XXH64(input.View())), input.View().size());
+
+    const fs::path image = fs::path(directory) / (std::string(key) + ".img");
+    const fs::path listing = fs::path(directory) / (std::string(key) + ".lst");
+
+    if (fs::exists(image) && fs::exists(listing)) {
+        try {
+            Image::Load(image.string().c_str(), cpu);
+
+            if (listingFilename != nullptr)
+                fs::copy_file(listing, listingFilename, fs::copy_options::overwrite_existing);
+
+            stats.cacheHits++;
+            return true;
+        } catch (const std::exception&) {
+            // Stale or corrupt entry (e.g. older image version). Rebuild it below; Disassemble overwrites
+            // every address a partial load could have touched, since the entry describes the same input.
+        }
+    }
+
+    stats.cacheMisses++;
+
+    // Always render the listing on a miss so later runs that ask for it can hit
+    const fs::path tempImage = TempPath(image);
+    const fs::path tempListing = TempPath(listing);
+
+    Disassemble(filename, cpu, tempListing.string().c_str());
+    Image::Save(cpu, tempImage.string().c_str());
+
+    if (listingFilename != nullptr)
+        fs::copy_file(tempListing, listingFilename, fs::copy_options::overwrite_existing);
+
+    Publish(tempImage, image);
+    Publish(tempListing, listing);
+
+    return false;
+}
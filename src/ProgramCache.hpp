@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace SPIMDF {
+    class CPU;
+    struct RunStats;
+
+    // On-disk cache of decoded programs, keyed by the XXH64 and size of the input file.
+    // Each entry is a program image (decoded text + initial data) and the rendered disassembly listing.
+    class ProgramCache {
+        std::string directory;
+
+        public:
+        explicit ProgramCache(std::string directory);
+
+        // Loads a textual program into the CPU, reusing the cached entry when there is one. If listingFilename is
+        // given, the cached listing is copied there. Returns true on a cache hit.
+        bool Load(const char* filename, CPU& cpu, RunStats& stats, const char* listingFilename = nullptr);
+    };
+}
@@ -0,0 +1,97 @@
+#include "Sampling.hpp"
+#include "CPU.hpp"
+#include "Functional.hpp"
+#include <cmath>
+#include <stdexcept>
+
+using namespace SPIMDF;
+
+namespace {
+    constexpr double Z95 = 1.96;
+}
+
+void SamplingConfig::Validate() const {
+    if (window == 0)
+        throw std::invalid_argument("Sampling window must not be empty");
+
+    if (warmup > period || window > period - warmup)
+        throw std::invalid_argument("Sampling warm-up plus window must fit in the period");
+}
+
+void SamplingReport::Print(std::FILE* out) const {
+    fprintf(out, "Sampled simulation\n");
+    fprintf(out, "\tInstructions:          %llu\n", static_cast<unsigned long long>(instructions));
+    fprintf(
+        out, "\tDetailed instructions: %llu (%.2f%%)\n"
+        , static_cast<unsigned long long>(detailedInstructions)
+        , instructions == 0 ? 0.0 : 100.0 * static_cast<double>(detailedInstructions) / static_cast<double>(instructions)
+    );
+    fprintf(out, "\tSamples:               %llu\n", static_cast<unsigned long long>(samples));
+
+    if (samples == 0) {
+        fprintf(out, "\tNo complete measurement window; use a shorter period\n");
+        return;
+    }
+
+    fprintf(out, "\tCPI:                   %.4f +/- %.4f (95%%, stddev %.4f)\n", cpiMean, cpiHalfWidth, cpiStdDev);
+    fprintf(out, "\tEstimated cycles:      %.0f +/- %.0f\n", EstimatedCycles(), CyclesHalfWidth());
+}
+
+SamplingReport SPIMDF::RunSampled(CPU& cpu, const SamplingConfig& config) {
+    config.Validate();
+
+    FunctionalEngine engine(cpu);
+    const FetchExec& fetch = cpu.executors.fetch;
+
+    if (config.useJit)
+        engine.EnableJit();
+
+    SamplingReport report;
+    double mean = 0; // Welford's running mean and sum of squared deviations
+    double m2 = 0;
+
+    while (true) {
+        engine.Run(config.period - config.warmup - config.window);
+
+        if (engine.IsHalted())
+            break;
+
+        // Detailed part of the period, from an empty pipeline at the engine's instruction boundary
+        cpu.ResetPipeline();
+
+        while (fetch.fetched < config.warmup && !fetch.isBroken)
+            cpu.Clock();
+
+        const uint64_t startCycle = cpu.GetCycle();
+        const uint64_t startFetched = fetch.fetched;
+
+        while (fetch.fetched < config.warmup + config.window && !fetch.isBroken)
+            cpu.Clock();
+
+        const uint64_t cycles = cpu.GetCycle() - startCycle;
+        const uint64_t measured = fetch.fetched - startFetched;
+
+        cpu.Drain(); // Hands the engine a clean instruction boundary; not measured
+        report.detailedInstructions += fetch.fetched;
+
+        if (fetch.isBroken)
+            break; // The program ended inside the window, which is then incomplete
+
+        const double cpi = static_cast<double>(cycles) / static_cast<double>(measured);
+        const double delta = cpi - mean;
+
+        report.samples++;
+        mean += delta / static_cast<double>(report.samples);
+        m2 += delta * (cpi - mean);
+    }
+
+    report.instructions = engine.GetRetired() + report.detailedInstructions;
+    report.cpiMean = mean;
+
+    if (report.samples > 1) {
+        report.cpiStdDev = std::sqrt(m2 / static_cast<double>(report.samples - 1));
+        report.cpiHalfWidth = Z95 * report.cpiStdDev / std::sqrt(static_cast<double>(report.samples));
+    }
+
+    return report;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace SPIMDF {
+    class CPU;
+
+    // Systematic sampling in the style of SMARTS. The program is cut into periods of `period` instructions.
+    // Each period is fast-forwarded functionally except for its last warmup + window instructions, which
+    // run in the pipeline. Only the window is measured; the warm-up refills the pipeline first.
+    struct SamplingConfig {
+        uint64_t period = 10000;
+        uint64_t warmup = 100;
+        uint64_t window = 1000;
+        bool useJit = false;
+
+        // Throws std::invalid_argument unless 0 < window and warmup + window <= period
+        void Validate() const;
+    };
+
+    struct SamplingReport {
+        uint64_t instructions = 0;         // Whole program
+        uint64_t detailedInstructions = 0; // Run in the pipeline, including warm-up and drains
+        uint64_t samples = 0;              // Complete measurement windows
+
+        // Per-window CPI
+        double cpiMean = 0;
+        double cpiStdDev = 0;
+        double cpiHalfWidth = 0; // Of the 95% confidence interval; 0 with fewer than two samples
+
+        double EstimatedCycles() const { return cpiMean * static_cast<double>(instructions); };
+        double CyclesHalfWidth() const { return cpiHalfWidth * static_cast<double>(instructions); };
+
+        void Print(std::FILE* out) const;
+    };
+
+    // Runs the program in cpu from its current PC to BREAK. The CPU must not have started clocking.
+    SamplingReport RunSampled(CPU& cpu, const SamplingConfig& config);
+}
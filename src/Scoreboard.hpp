@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
+
+namespace SPIMDF {
+    enum class Hazard {
+          RAW
+        , WAW
+        , WAR
+    };
+
+    // Tracks which registers are locked by issued, unfinished instructions.
+    // Reads are reference counted so that a retiring reader only releases its own lock.
+    class Scoreboard {
+        public:
+        // Plain copy of the scoreboard, for checkpointing
+        struct State {
+            uint32_t pendingReadMask = 0;
+            uint32_t pendingWriteMask = 0;
+            std::array<uint8_t, 32> readers{};
+        };
+
+        private:
+        State state;
+
+        public:
+        // Called when an instruction is issued
+        void Acquire(const Instruction& instr) {
+            for (uint32_t reads = instr.ReadMask(); reads != 0; reads &= reads - 1)
+                state.readers[std::countr_zero(reads)]++;
+
+            state.pendingReadMask |= instr.ReadMask();
+            state.pendingWriteMask |= instr.WriteMask();
+        }
+
+        // Called when an instruction finishes or is flushed
+        void Release(const Instruction& instr) {
+            for (uint32_t reads = instr.ReadMask(); reads != 0; reads &= reads - 1) {
+                const int reg = std::countr_zero(reads);
+
+                if (state.readers[reg] != 0 && --state.readers[reg] == 0)
+                    state.pendingReadMask &= ~(1u << reg);
+            }
+
+            state.pendingWriteMask &= ~instr.WriteMask(); // WAW hazards keep writers to one register unique
+        }
+
+        bool IsPendingRead(uint8_t reg) const { return (state.pendingReadMask >> reg) & 1; };
+        bool IsPendingWrite(uint8_t reg) const { return (state.pendingWriteMask >> reg) & 1; };
+
+        uint32_t PendingReadMask() const { return state.pendingReadMask; };
+        uint32_t PendingWriteMask() const { return state.pendingWriteMask; };
+
+        // True if instr conflicts with any locked register under the given hazard kinds
+        template<Hazard... Args>
+        bool HasHazard(const Instruction& instr) const {
+            static_assert(sizeof...(Args) > 0);
+
+            uint32_t conflicts = 0;
+
+            if constexpr (((Args == Hazard::RAW) || ...))
+                conflicts |= instr.ReadMask() & state.pendingWriteMask;
+
+            if constexpr (((Args == Hazard::WAW) || ...))
+                conflicts |= instr.WriteMask() & state.pendingWriteMask;
+
+            if constexpr (((Args == Hazard::WAR) || ...))
+                conflicts |= instr.WriteMask() & state.pendingReadMask;
+
+            return conflicts != 0;
+        }
+
+        State Snapshot() const { return state; };
+        void Restore(const State& snapshot) { state = snapshot; };
+        void Clear() { state = State(); };
+    };
+}
@@ -0,0 +1,303 @@
+#include "SimPoint.hpp"
+#include "CPU.hpp"
+#include "Functional.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace SPIMDF;
+using namespace SPIMDF::SimPoint;
+
+namespace {
+    using Vector = std::array<double, ProjectedDims>;
+
+    // Entry (id, dim) of the projection matrix, uniform in [-1, 1). Hashed rather than stored so the matrix
+    // grows with the program without being sized up front.
+    double ProjectionEntry(uint64_t seed, uint32_t id, std::size_t dim) {
+        const uint64_t key[2] = { id, dim };
+        const uint64_t h = XXH64(std::string_view(reinterpret_cast<const char*>(key), sizeof(key)), seed);
+
+        return static_cast<double>(h >> 11) * 0x1.0p-52 - 1.0;
+    }
+
+    double Distance2(const Vector& a, const Vector& b) {
+        double d = 0;
+
+        for (std::size_t i = 0; i < ProjectedDims; i++)
+            d += (a[i] - b[i]) * (a[i] - b[i]);
+
+        return d;
+    }
+
+    // k-means++ seeding, then Lloyd's iterations until no interval changes cluster. Returns each vector's cluster.
+    std::vector<unsigned> Cluster(const std::vector<Vector>& vectors, unsigned k, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<Vector> centres;
+        std::vector<double> nearest(vectors.size(), std::numeric_limits<double>::max());
+
+        centres.push_back(vectors[std::uniform_int_distribution<std::size_t>(0, vectors.size() - 1)(rng)]);
+
+        while (centres.size() < k) {
+            for (std::size_t i = 0; i < vectors.size(); i++)
+                nearest[i] = std::min(nearest[i], Distance2(vectors[i], centres.back()));
+
+            if (std::all_of(nearest.begin(), nearest.end(), [](double d) { return d == 0; }))
+                break; // Fewer distinct vectors than clusters
+
+            std::discrete_distribution<std::size_t> pick(nearest.begin(), nearest.end());
+            centres.push_back(vectors[pick(rng)]);
+        }
+
+        std::vector<unsigned> assignment(vectors.size(), 0);
+
+        for (int iteration = 0; iteration < 100; iteration++) {
+            bool changed = false;
+
+            for (std::size_t i = 0; i < vectors.size(); i++) {
+                unsigned best = 0;
+
+                for (unsigned c = 1; c < centres.size(); c++) {
+                    if (Distance2(vectors[i], centres[c]) < Distance2(vectors[i], centres[best]))
+                        best = c;
+                }
+
+                changed |= assignment[i] != best;
+                assignment[i] = best;
+            }
+
+            if (!changed && iteration != 0)
+                break;
+
+            std::vector<Vector> sums(centres.size(), Vector{});
+            std::vector<std::size_t> sizes(centres.size(), 0);
+
+            for (std::size_t i = 0; i < vectors.size(); i++) {
+                for (std::size_t d = 0; d < ProjectedDims; d++)
+                    sums[assignment[i]][d] += vectors[i][d];
+
+                sizes[assignment[i]]++;
+            }
+
+            for (std::size_t c = 0; c < centres.size(); c++) {
+                if (sizes[c] == 0)
+                    continue; // Keep an emptied centre where it was
+
+                for (std::size_t d = 0; d < ProjectedDims; d++)
+                    centres[c][d] = sums[c][d] / static_cast<double>(sizes[c]);
+            }
+        }
+
+        return assignment;
+    }
+}
+
+void Config::Validate() const {
+    if (interval == 0)
+        throw std::invalid_argument("SimPoint interval must not be empty");
+
+    if (clusters == 0)
+        throw std::invalid_argument("SimPoint needs at least one cluster");
+}
+
+void Points::Save(const char* filename) const {
+    std::ofstream file(filename);
+
+    if (!file)
+        throw std::runtime_error(std::string("Cannot write ") + filename);
+
+    file << "interval " << interval << '\n';
+    file << "instructions " << instructions << '\n';
+
+    for (const Point& p : points)
+        file << "point " << p.interval << ' ' << p.weight << '\n';
+}
+
+Points Points::Load(const char* filename) {
+    std::ifstream file(filename);
+
+    if (!file)
+        throw std::runtime_error(std::string("File not found: ") + filename);
+
+    Points result;
+    std::string key;
+
+    while (file >> key) {
+        if (key == "interval")
+            file >> result.interval;
+        else if (key == "instructions")
+            file >> result.instructions;
+        else if (key == "point") {
+            Point p;
+            file >> p.interval >> p.weight;
+            result.points.push_back(p);
+        } else
+            throw std::runtime_error("Unknown key \"" + key + "\" in " + filename);
+
+        if (!file)
+            throw std::runtime_error(std::string("Malformed simulation points in ") + filename);
+    }
+
+    if (result.interval == 0)
+        throw std::runtime_error(std::string("No interval in ") + filename);
+
+    std::sort(result.points.begin(), result.points.end(), [](const Point& a, const Point& b) {
+        return a.interval < b.interval;
+    });
+
+    return result;
+}
+
+Points SimPoint::Profile(CPU& cpu, const Config& config) {
+    config.Validate();
+
+    FunctionalEngine engine(cpu);
+    std::vector<uint64_t> counts;
+    std::vector<Vector> vectors;
+    std::vector<uint64_t> lengths; // Instructions in each interval; only the last can be short
+
+    if (config.useJit)
+        engine.EnableJit();
+
+    engine.SetBlockProfile(&counts);
+
+    while (!engine.IsHalted()) {
+        std::fill(counts.begin(), counts.end(), 0);
+
+        const uint64_t length = engine.Run(config.interval);
+
+        if (length == 0)
+            break;
+
+        Vector projected{};
+
+        for (uint32_t id = 0; id < counts.size(); id++) {
+            if (counts[id] == 0)
+                continue;
+
+            const double frequency = static_cast<double>(counts[id]) / static_cast<double>(length);
+
+            for (std::size_t d = 0; d < ProjectedDims; d++)
+                projected[d] += frequency * ProjectionEntry(config.seed, id, d);
+        }
+
+        vectors.push_back(projected);
+        lengths.push_back(length);
+    }
+
+    Points result;
+    result.interval = config.interval;
+    result.instructions = engine.GetRetired();
+
+    if (vectors.empty())
+        return result;
+
+    const unsigned k = static_cast<unsigned>(std::min<std::size_t>(config.clusters, vectors.size()));
+    const std::vector<unsigned> assignment = Cluster(vectors, k, config.seed);
+
+    // Centre of each cluster, then the interval nearest to it
+    std::vector<Vector> centres(k, Vector{});
+    std::vector<uint64_t> sizes(k, 0);
+    std::vector<uint64_t> instructions(k, 0);
+
+    for (std::size_t i = 0; i < vectors.size(); i++) {
+        for (std::size_t d = 0; d < ProjectedDims; d++)
+            centres[assignment[i]][d] += vectors[i][d];
+
+        sizes[assignment[i]]++;
+        instructions[assignment[i]] += lengths[i];
+    }
+
+    for (unsigned c = 0; c < k; c++) {
+        if (sizes[c] == 0)
+            continue;
+
+        for (std::size_t d = 0; d < ProjectedDims; d++)
+            centres[c][d] /= static_cast<double>(sizes[c]);
+
+        std::size_t best = vectors.size();
+
+        for (std::size_t i = 0; i < vectors.size(); i++) {
+            if (assignment[i] != c)
+                continue;
+
+            if (best == vectors.size() || Distance2(vectors[i], centres[c]) < Distance2(vectors[best], centres[c]))
+                best = i;
+        }
+
+        result.points.push_back(Point{ best, static_cast<double>(instructions[c]) / static_cast<double>(result.instructions) });
+    }
+
+    std::sort(result.points.begin(), result.points.end(), [](const Point& a, const Point& b) {
+        return a.interval < b.interval;
+    });
+
+    return result;
+}
+
+void Estimate::Print(std::FILE* out) const {
+    fprintf(out, "SimPoint estimate\n");
+    fprintf(out, "\tCPI:                   %.4f\n", cpi);
+    fprintf(out, "\tEstimated cycles:      %.0f\n", cycles);
+    fprintf(out, "\tDetailed instructions: %llu\n", static_cast<unsigned long long>(detailedInstructions));
+}
+
+Estimate SimPoint::Simulate(CPU& cpu, const Points& points, uint64_t warmup, bool useJit) {
+    FunctionalEngine engine(cpu);
+    const FetchExec& fetch = cpu.executors.fetch;
+    Estimate estimate;
+    uint64_t position = 0; // Instructions run so far, by either engine
+    double totalWeight = 0;
+
+    if (useJit)
+        engine.EnableJit();
+
+    for (const Point& point : points.points) {
+        const uint64_t start = point.interval * points.interval;
+        const uint64_t warmStart = std::max(position, start > warmup ? start - warmup : 0);
+
+        position += engine.Run(warmStart - position);
+
+        if (engine.IsHalted())
+            break;
+
+        cpu.ResetPipeline();
+
+        // Fetch takes several instructions a cycle, so position can already be a little past start
+        const uint64_t warm = start > position ? start - position : 0;
+
+        while (fetch.fetched < warm && !fetch.isBroken)
+            cpu.Clock();
+
+        const uint64_t startCycle = cpu.GetCycle();
+        const uint64_t startFetched = fetch.fetched;
+
+        while (fetch.fetched < warm + points.interval && !fetch.isBroken)
+            cpu.Clock();
+
+        const uint64_t cycles = cpu.GetCycle() - startCycle;
+        const uint64_t measured = fetch.fetched - startFetched;
+
+        cpu.Drain();
+        position += fetch.fetched;
+        estimate.detailedInstructions += fetch.fetched;
+
+        if (measured != 0) {
+            estimate.cpi += point.weight * static_cast<double>(cycles) / static_cast<double>(measured);
+            totalWeight += point.weight;
+        }
+
+        if (fetch.isBroken)
+            break;
+    }
+
+    if (totalWeight != 0)
+        estimate.cpi /= totalWeight; // Points that could not run are left out rather than counted as zero
+
+    estimate.cycles = estimate.cpi * static_cast<double>(points.instructions);
+    return estimate;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace SPIMDF {
+    class CPU;
+
+    // SimPoint-style phase analysis. A functional profiling pass cuts the run into fixed-size intervals and
+    // records a basic-block vector for each (instructions run per block, blocks ending at jumps; see
+    // BlockCache). The vectors are normalised, randomly projected down to ProjectedDims dimensions and
+    // clustered with k-means. The interval closest to each cluster's centre stands in for the whole cluster,
+    // weighted by the cluster's share of the instructions.
+    namespace SimPoint {
+        inline constexpr std::size_t ProjectedDims = 15;
+
+        struct Config {
+            uint64_t interval = 100000; // Instructions
+            unsigned clusters = 10;     // At most; fewer if there are fewer intervals
+            uint64_t seed = 1;          // For the projection and the k-means initialisation
+            bool useJit = false;
+
+            // Throws std::invalid_argument if interval or clusters is zero
+            void Validate() const;
+        };
+
+        struct Point {
+            uint64_t interval; // Index; starts at instruction interval * Points::interval
+            double weight;
+        };
+
+        struct Points {
+            uint64_t interval = 0;
+            uint64_t instructions = 0; // Whole program
+            std::vector<Point> points; // By interval
+
+            // Text file, one "key value..." per line: interval, instructions, then a "point" line per point.
+            // Load throws std::runtime_error on a missing or malformed file.
+            void Save(const char* filename) const;
+            static Points Load(const char* filename);
+        };
+
+        // Runs the program in cpu functionally from its current PC to BREAK and picks the simulation points
+        Points Profile(CPU& cpu, const Config& config);
+
+        struct Estimate {
+            double cpi = 0;              // Weighted over the points
+            double cycles = 0;           // cpi times the program's instructions
+            uint64_t detailedInstructions = 0;
+
+            void Print(std::FILE* out) const;
+        };
+
+        // Fast-forwards the program in cpu to each point and runs the point's interval in the pipeline,
+        // after warmup instructions that are run in the pipeline but not measured
+        Estimate Simulate(CPU& cpu, const Points& points, uint64_t warmup, bool useJit = false);
+    }
+}
@@ -0,0 +1,345 @@
+#include "Snapshot.hpp"
+#include "CPU.hpp"
+#include "Loader.hpp"
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using namespace SPIMDF;
+
+namespace {
+    class Writer {
+        std::string& bytes;
+
+        public:
+        explicit Writer(std::string& bytes) : bytes(bytes) { };
+
+        template<typename T>
+        void Put(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void Put(const Instruction& instr) { Put(Image::ToRecord(instr)); };
+        void Put(bool flag) { Put(uint8_t{ flag }); };
+    };
+
+    class Reader {
+        std::string_view bytes;
+
+        public:
+        explicit Reader(std::string_view bytes) : bytes(bytes) { };
+
+        template<typename T>
+        T Get() {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            if (bytes.size() < sizeof(T))
+                throw std::runtime_error("Snapshot truncated");
+
+            T value;
+            std::memcpy(&value, bytes.data(), sizeof(T));
+            bytes.remove_prefix(sizeof(T));
+            return value;
+        }
+
+        // A count read from the file, checked against the room left for its records. Check before GetArray().
+        std::size_t GetCount(std::size_t count, std::size_t recordSize) const {
+            if (bytes.size() / recordSize < count)
+                throw std::runtime_error("Snapshot truncated");
+
+            return count;
+        }
+
+        template<typename T>
+        void GetArray(T* values, std::size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::memcpy(values, bytes.data(), count * sizeof(T));
+            bytes.remove_prefix(count * sizeof(T));
+        }
+
+        Instruction GetInstr() { return Image::FromRecord(Get<Image::InstrRecord>()); };
+        bool GetFlag() { return Get<uint8_t>() != 0; };
+        bool AtEnd() const { return bytes.empty(); };
+    };
+
+    // The queues are written as a count and that many entries, front first
+    template<typename Queue>
+    void PutQueue(Writer& out, const Queue& queue) {
+        out.Put(static_cast<uint32_t>(queue.entries.size()));
+
+        for (const auto& entry : queue.entries) {
+            out.Put(entry.instruction);
+
+            if constexpr (requires { entry.result; })
+                out.Put(entry.result);
+
+            if constexpr (requires { entry.address; })
+                out.Put(entry.address);
+        }
+    }
+
+    template<typename Queue>
+    void GetQueue(Reader& in, Queue& queue) {
+        using Entry = std::remove_cvref_t<decltype(queue.entries[0])>;
+        const uint32_t count = in.Get<uint32_t>();
+
+        if (count > queue.entries.capacity())
+            throw std::runtime_error("Snapshot queue larger than the pipeline's");
+
+        for (uint32_t i = 0; i < count; i++) {
+            Entry entry{ in.GetInstr() };
+
+            if constexpr (requires { entry.result; })
+                entry.result = in.Get<decltype(entry.result)>();
+
+            if constexpr (requires { entry.address; })
+                entry.address = in.Get<decltype(entry.address)>();
+
+            // The pre-issue queue rebuilds its dependency rows as the entries go back in, in order
+            if constexpr (requires { queue.Push(entry.instruction); })
+                queue.Push(entry.instruction);
+            else
+                queue.entries.push_back(std::move(entry));
+        }
+    }
+
+    template<typename Entry>
+    void PutOptional(Writer& out, const std::optional<Entry>& slot) {
+        out.Put(slot.has_value());
+
+        if (slot.has_value()) {
+            out.Put(slot->instruction);
+
+            if constexpr (requires { slot->result; })
+                out.Put(slot->result);
+
+            if constexpr (requires { slot->address; })
+                out.Put(slot->address);
+        }
+    }
+
+    template<typename Entry>
+    void GetOptional(Reader& in, std::optional<Entry>& slot) {
+        if (!in.GetFlag()) {
+            slot.reset();
+            return;
+        }
+
+        Entry entry{ in.GetInstr() };
+
+        if constexpr (requires { entry.result; })
+            entry.result = in.Get<decltype(entry.result)>();
+
+        if constexpr (requires { entry.address; })
+            entry.address = in.Get<decltype(entry.address)>();
+
+        slot = entry;
+    }
+
+    template<std::size_t N>
+    void PutSlots(Writer& out, const std::array<Instruction, N>& slots, std::size_t numSlots) {
+        out.Put(static_cast<uint32_t>(numSlots));
+
+        for (std::size_t i = 0; i < numSlots; i++)
+            out.Put(slots[i]);
+    }
+
+    template<std::size_t N>
+    std::size_t GetSlots(Reader& in, std::array<Instruction, N>& slots) {
+        const uint32_t numSlots = in.Get<uint32_t>();
+
+        if (numSlots > N)
+            throw std::runtime_error("Snapshot stage wider than the pipeline's");
+
+        for (uint32_t i = 0; i < numSlots; i++)
+            slots[i] = in.GetInstr();
+
+        return numSlots;
+    }
+}
+
+std::string Snapshot::Serialize(const CPU& cpu) {
+    const auto& memory = cpu.memory;
+
+    Header header;
+    header.magic = Magic;
+    header.version = Version;
+    header.recordSize = sizeof(Image::InstrRecord);
+    header.geometry = {
+          cpu.config.preIssueDepth, cpu.config.preALUDepth, cpu.config.preMemALUDepth
+        , cpu.config.fetchWidth, cpu.config.issueWidth
+    };
+    header.pc = cpu.pc;
+    header.cycle = cpu.cycle;
+    header.stageCalls = cpu.stageCalls;
+    header.stageSkips = cpu.stageSkips;
+    header.skippedCycles = cpu.skippedCycles;
+    header.programCount = static_cast<uint32_t>(cpu.program.size());
+    header.rawTextBase = cpu.rawTextBase;
+    header.rawTextCount = static_cast<uint32_t>(cpu.rawText.size());
+    header.memoryRuns = 0; // Counted as they are written
+
+    // Allocated once: memory is at most a run header per word, and the pipeline section is small
+    std::string bytes;
+    bytes.reserve(
+          sizeof(Header) + 32 * sizeof(int32_t) + sizeof(Scoreboard::State)
+        + cpu.program.size() * sizeof(ProgramRecord) + cpu.rawText.size() * sizeof(uint32_t)
+        + memory.size() * (sizeof(MemoryRun) + sizeof(int32_t)) + 1024
+    );
+
+    Writer out(bytes);
+    out.Put(header);
+
+    for (const auto& reg : cpu.registers)
+        out.Put(reg.value);
+
+    out.Put(cpu.scoreboard.Snapshot());
+
+    for (const auto& [addr, instr] : cpu.program)
+        out.Put(ProgramRecord{ addr, Image::ToRecord(instr) });
+
+    bytes.append(reinterpret_cast<const char*>(cpu.rawText.data()), cpu.rawText.size() * sizeof(uint32_t));
+
+    std::size_t runAt = 0; // Offset of the open run's header
+    MemoryRun run{ 0, 0 };
+
+    for (const auto& [addr, datum] : memory) {
+        if (run.count == 0 || addr != run.base + 4 * run.count) {
+            if (run.count != 0)
+                std::memcpy(bytes.data() + runAt, &run, sizeof(run));
+
+            runAt = bytes.size();
+            run = MemoryRun{ addr, 0 };
+            out.Put(run);
+            header.memoryRuns++;
+        }
+
+        out.Put(datum);
+        run.count++;
+    }
+
+    if (run.count != 0)
+        std::memcpy(bytes.data() + runAt, &run, sizeof(run));
+
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    const CPU::Stages& stages = cpu.executors;
+
+    PutSlots(out, stages.fetch.slots, stages.fetch.numSlots);
+    out.Put(stages.fetch.staller);
+    out.Put(stages.fetch.executed);
+    out.Put(stages.fetch.isBroken);
+    out.Put(stages.fetch.fetched);
+    PutSlots(out, stages.issue.slots, stages.issue.numSlots);
+    out.Put(stages.alu.slot);
+    out.Put(stages.memALU.slot);
+    PutOptional(out, stages.mem.slot);
+    PutOptional(out, stages.writeback.slotALU);
+    PutOptional(out, stages.writeback.slotMem);
+
+    PutQueue(out, cpu.queues.preIssue);
+    PutQueue(out, cpu.queues.preALU);
+    PutQueue(out, cpu.queues.postALU);
+    PutQueue(out, cpu.queues.preMemALU);
+    PutQueue(out, cpu.queues.preMem);
+    PutQueue(out, cpu.queues.postMem);
+
+    return bytes;
+}
+
+CPU Snapshot::Deserialize(std::string_view bytes) {
+    Reader in(bytes);
+    const Header header = in.Get<Header>();
+
+    if (header.magic != Magic)
+        throw std::runtime_error("Not a CPU snapshot");
+    if (header.version != Version)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+    if (header.recordSize != sizeof(Image::InstrRecord))
+        throw std::runtime_error("Unsupported snapshot record size");
+
+    PipelineConfig config;
+    config.preIssueDepth = header.geometry[0];
+    config.preALUDepth = header.geometry[1];
+    config.preMemALUDepth = header.geometry[2];
+    config.fetchWidth = header.geometry[3];
+    config.issueWidth = header.geometry[4];
+
+    CPU cpu(header.pc, config);
+    cpu.cycle = header.cycle;
+    cpu.stageCalls = header.stageCalls;
+    cpu.stageSkips = header.stageSkips;
+    cpu.skippedCycles = header.skippedCycles;
+
+    for (auto& reg : cpu.registers)
+        reg.value = in.Get<int32_t>();
+
+    cpu.scoreboard.Restore(in.Get<Scoreboard::State>());
+
+    for (std::size_t i = in.GetCount(header.programCount, sizeof(ProgramRecord)); i > 0; i--) {
+        const auto record = in.Get<ProgramRecord>();
+        cpu.LoadInstr(record.address, Image::FromRecord(record.record));
+    }
+
+    std::vector<uint32_t> rawText(in.GetCount(header.rawTextCount, sizeof(uint32_t)));
+    in.GetArray(rawText.data(), rawText.size());
+
+    cpu.LoadRawText(header.rawTextBase, std::move(rawText));
+
+    // Saved by address, so every insertion is at the end of the map
+    for (std::size_t r = in.GetCount(header.memoryRuns, sizeof(MemoryRun)); r > 0; r--) {
+        const auto run = in.Get<MemoryRun>();
+
+        for (std::size_t i = in.GetCount(run.count, sizeof(int32_t)), addr = run.base; i > 0; i--, addr += 4)
+            cpu.LoadMem(static_cast<uint32_t>(addr), in.Get<int32_t>());
+    }
+
+    CPU::Stages& stages = cpu.executors;
+
+    stages.fetch.numSlots = GetSlots(in, stages.fetch.slots);
+    stages.fetch.staller = in.GetInstr();
+    stages.fetch.executed = in.GetInstr();
+    stages.fetch.isBroken = in.GetFlag();
+    stages.fetch.fetched = in.Get<uint64_t>();
+    stages.issue.numSlots = GetSlots(in, stages.issue.slots);
+    stages.alu.slot = in.GetInstr();
+    stages.memALU.slot = in.GetInstr();
+    GetOptional(in, stages.mem.slot);
+    GetOptional(in, stages.writeback.slotALU);
+    GetOptional(in, stages.writeback.slotMem);
+
+    GetQueue(in, cpu.queues.preIssue);
+    GetQueue(in, cpu.queues.preALU);
+    GetQueue(in, cpu.queues.postALU);
+    GetQueue(in, cpu.queues.preMemALU);
+    GetQueue(in, cpu.queues.preMem);
+    GetQueue(in, cpu.queues.postMem);
+
+    if (!in.AtEnd())
+        throw std::runtime_error("Trailing bytes after snapshot");
+
+    return cpu;
+}
+
+void Snapshot::Save(const CPU& cpu, const char* filename) {
+    const std::string bytes = Serialize(cpu);
+    std::ofstream output(filename, std::ios::binary);
+
+    output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+    if (!output)
+        throw std::runtime_error(std::string("Failed to write snapshot: ") + filename);
+}
+
+CPU Snapshot::Load(const char* filename) {
+    MappedFile input(filename);
+
+    if (!input.IsOpen())
+        throw std::runtime_error(std::string("File not found: ") + filename);
+
+    return Deserialize(input.View());
+}
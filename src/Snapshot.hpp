@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Image.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace SPIMDF {
+    class CPU;
+
+    // Binary snapshot of a whole CPU, pipeline included, so a run can be resumed cycle-exactly.
+    // Layout (host byte order):
+    //   Header
+    //   Registers: 32 int32_t
+    //   Scoreboard::State
+    //   Program: header.programCount ProgramRecords, the instructions decoded so far
+    //   Raw text: header.rawTextCount uint32_t words, loaded at header.rawTextBase
+    //   Memory: header.memoryRuns runs of consecutive words, by address; each is a MemoryRun, then
+    //           run.count int32_t words starting at run.base
+    //   Pipeline: every stage's slots, then the six queues, front first (see Serialize)
+    // Instructions are stored as Image::InstrRecords.
+    namespace Snapshot {
+        inline constexpr std::array<char, 8> Magic = { 'S', 'P', 'I', 'M', 'D', 'F', 'S', 'N' };
+        inline constexpr uint32_t Version = 1;
+
+        struct Header {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t recordSize;
+            std::array<uint32_t, 5> geometry; // PipelineConfig, in declaration order
+            uint32_t pc;
+            uint64_t cycle;
+            uint64_t stageCalls;
+            uint64_t stageSkips;
+            uint64_t skippedCycles;
+            uint32_t programCount;
+            uint32_t rawTextBase;
+            uint32_t rawTextCount;
+            uint32_t memoryRuns;
+        };
+
+        struct ProgramRecord {
+            uint32_t address;
+            Image::InstrRecord record;
+        };
+
+        struct MemoryRun {
+            uint32_t base;
+            uint32_t count;
+        };
+
+        static_assert(sizeof(Header) == 88);
+        static_assert(sizeof(ProgramRecord) == 16);
+        static_assert(sizeof(MemoryRun) == 8);
+
+        std::string Serialize(const CPU& cpu);
+
+        // Builds a CPU with the snapshot's pipeline geometry. Throws std::runtime_error on a malformed snapshot.
+        CPU Deserialize(std::string_view bytes);
+
+        void Save(const CPU& cpu, const char* filename);
+        CPU Load(const char* filename);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace SPIMDF {
+    // Counters reported at the end of a run with --stats
+    struct RunStats {
+        uint64_t cacheHits = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t stageCalls = 0;
+        uint64_t stageSkips = 0;
+        uint64_t skippedCycles = 0;
+        uint64_t fastForwarded = 0;
+        uint64_t compiledBlocks = 0;
+
+        void Print(std::FILE* out) const {
+            fprintf(out, "Run statistics\n");
+            fprintf(out, "\tProgram cache hits:   %llu\n", static_cast<unsigned long long>(cacheHits));
+            fprintf(out, "\tProgram cache misses: %llu\n", static_cast<unsigned long long>(cacheMisses));
+            fprintf(
+                out, "\tIdle stage calls skipped: %llu of %llu (%.1f%%)\n"
+                , static_cast<unsigned long long>(stageSkips)
+                , static_cast<unsigned long long>(stageCalls)
+                , stageCalls == 0 ? 0.0 : 100.0 * static_cast<double>(stageSkips) / static_cast<double>(stageCalls)
+            );
+            fprintf(out, "\tQuiescent cycles skipped: %llu\n", static_cast<unsigned long long>(skippedCycles));
+            fprintf(out, "\tInstructions fast-forwarded: %llu\n", static_cast<unsigned long long>(fastForwarded));
+            fprintf(out, "\tBlocks compiled to native code: %llu\n", static_cast<unsigned long long>(compiledBlocks));
+        }
+    };
+}
@@ -0,0 +1,86 @@
+#include "Trace.hpp"
+#include "CPU.hpp"
+#include <cstdio>
+
+using namespace SPIMDF;
+
+void SPIMDF::WriteCycleTrace(std::ostream& output, const CPU& cpu, uint64_t cycle) {
+    char buffer[200];
+
+    output << "--------------------\n";
+    
+    sprintf(buffer, "Cycle %llu:\n\n", static_cast<unsigned long long>(cycle));
+    output << buffer;
+
+    // Execution Units
+    output << "IF Unit:\n";
+    if (cpu.executors.fetch.staller.IsNop())
+        output << "\tWaiting Instruction:\n"; 
+    else
+        output << "\tWaiting Instruction: [" << cpu.executors.fetch.staller.ToString() << "]\n";
+
+    if (cpu.executors.fetch.executed.IsNop())
+        output << "\tExecuted Instruction:\n";
+    else
+        output << "\tExecuted Instruction: [" << cpu.executors.fetch.executed.ToString() << "]\n";
+
+    // Pre-Issue Queue
+    output << "Pre-Issue Queue:\n";
+    output << cpu.queues.preIssue.ToPrintingString();
+
+    // Pre-MemALU Queue
+    output << "Pre-ALU1 Queue:\n";
+    output << cpu.queues.preMemALU.ToPrintingString();
+
+    // Pre-Mem Queue
+    output << "Pre-MEM Queue:";
+    output << cpu.queues.preMem.ToPrintingString() << '\n';
+
+    // Post-Mem Queue
+    output << "Post-MEM Queue:";
+    output << cpu.queues.postMem.ToPrintingString() << '\n';
+
+    // Pre-ALU Queue
+    output << "Pre-ALU2 Queue:\n";
+    output << cpu.queues.preALU.ToPrintingString();
+
+    // Post-ALU Queue
+    output << "Post-ALU2 Queue:";
+    output << cpu.queues.postALU.ToPrintingString() << '\n';
+
+    // Print registers
+    uint8_t base = 0;
+    output << "\nRegisters\n";
+
+    for (uint8_t row = 0; row < 4; row++) {
+        sprintf(
+            buffer
+            , "R%02u:\t%i\t%i\t%i\t%i\t%i\t%i\t%i\t%i\n"
+            , base
+            , cpu.Reg(base + 0), cpu.Reg(base + 1), cpu.Reg(base + 2), cpu.Reg(base + 3)
+            , cpu.Reg(base + 4), cpu.Reg(base + 5), cpu.Reg(base + 6), cpu.Reg(base + 7)
+        );
+
+        output << buffer;
+
+        base += 8;
+    }
+
+    // Print memory
+    uint8_t word = 0;
+    output << "\nData\n";
+
+    for (auto [addr, datum] : cpu.GetAllMem()) {
+        if (word == 0)
+            output << addr << ":\t";
+        
+        output << datum;
+
+        if (word++ != 7)
+            output << "\t";
+        else {
+            word = 0;
+            output << "\n";
+        }
+    }
+}
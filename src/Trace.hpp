@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace SPIMDF {
+    class CPU;
+
+    // Writes the simulation.txt record for one cycle: the cycle header followed by the state of the
+    // pipeline, registers and memory as they are now (i.e. after that cycle has been clocked).
+    // Quiescent cycles leave the state untouched, so their records can be written from the same state.
+    void WriteCycleTrace(std::ostream& output, const CPU& cpu, uint64_t cycle);
+}
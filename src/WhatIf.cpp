@@ -0,0 +1,279 @@
+#include "WhatIf.hpp"
+#include "CPU.hpp"
+#include "Hash.hpp"
+#include "PipelineConfig.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#if SPIMDF_FORK
+    #include <cerrno>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+using namespace SPIMDF;
+
+namespace {
+    template<typename T>
+    T ParseNumber(std::string_view text, std::string_view edit) {
+        T value{};
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+        if (text.empty() || ec != std::errc() || end != text.data() + text.size())
+            throw std::invalid_argument("Invalid state edit \"" + std::string(edit) + "\"");
+
+        return value;
+    }
+
+    // Registers, then memory in address order
+    uint64_t HashState(const CPU& cpu) {
+        std::string bytes;
+        bytes.reserve(32 * sizeof(int32_t) + cpu.GetAllMem().size() * 2 * sizeof(int32_t));
+
+        for (uint8_t r = 0; r < 32; r++)
+            bytes.append(reinterpret_cast<const char*>(&cpu.Reg(r)), sizeof(int32_t));
+
+        for (const auto& [addr, datum] : cpu.GetAllMem()) {
+            bytes.append(reinterpret_cast<const char*>(&addr), sizeof(addr));
+            bytes.append(reinterpret_cast<const char*>(&datum), sizeof(datum));
+        }
+
+        return XXH64(bytes);
+    }
+}
+
+void StateEdit::Apply(CPU& cpu) const {
+    if (kind == Kind::Memory)
+        cpu.Mem(target) = value;
+    else if (kind == Kind::Register)
+        cpu.Reg(static_cast<uint8_t>(target)) = value;
+}
+
+void StateEdit::Apply(PipelineConfig& config) const {
+    if (kind == Kind::Pipeline)
+        config.Set(assignment);
+}
+
+std::vector<StateEdit> StateEdit::ParseList(std::string_view list) {
+    std::vector<StateEdit> edits;
+
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        const std::string_view edit = list.substr(0, comma);
+        const std::size_t eq = edit.find('=');
+
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        if (edit.size() < 2 || eq == std::string_view::npos) {
+            throw std::invalid_argument(
+                "Expected R<reg>=<value>, M<address>=<value> or <pipeline key>=<value>, got \"" + std::string(edit) + "\""
+            );
+        }
+
+        StateEdit parsed;
+
+        // Pipeline keys are lower case, so they never start with R or M
+        if (edit[0] != 'R' && edit[0] != 'M') {
+            parsed.kind = Kind::Pipeline;
+            parsed.assignment = edit;
+
+            PipelineConfig check;
+            check.Set(edit); // Throws on an unknown key or bad value now rather than in the child
+
+            edits.push_back(std::move(parsed));
+            continue;
+        }
+
+        parsed.kind = edit[0] == 'M' ? Kind::Memory : Kind::Register;
+        parsed.target = ParseNumber<uint32_t>(edit.substr(1, eq - 1), edit);
+        parsed.value = ParseNumber<int32_t>(edit.substr(eq + 1), edit);
+
+        if (parsed.kind == Kind::Register && parsed.target >= 32)
+            throw std::invalid_argument("No register " + std::to_string(parsed.target));
+
+        edits.push_back(parsed);
+    }
+
+    return edits;
+}
+
+void CheckpointTree::Print(const std::vector<Record>& records, std::FILE* out) {
+    fprintf(out, "What-if runs\n");
+
+    if (records.empty()) {
+        fprintf(out, "\tNone; the program reached BREAK before the checkpoint\n");
+        return;
+    }
+
+    std::multimap<int32_t, const Record*> byParent;
+
+    for (const Record& r : records)
+        byParent.emplace(r.parent, &r);
+
+    // Roots are the records whose parent ran no variant
+    const auto isNode = [&](int32_t pid) {
+        return std::any_of(records.begin(), records.end(), [&](const Record& r) { return r.node == pid; });
+    };
+
+    const auto print = [&](const auto& self, const Record& r, int depth) -> void {
+        static constexpr const char* outcomes[] = { "BREAK", "cycle limit", "failed" };
+
+        fprintf(
+            out, "\t%*s%-*s from cycle %llu: %llu cycles, %llu instructions, CPI %.4f, PC %u, state %016llx (%s)\n"
+            , 2 * depth, "", std::max(1, 24 - 2 * depth), r.label.data()
+            , static_cast<unsigned long long>(r.checkpointCycle), static_cast<unsigned long long>(r.cycles)
+            , static_cast<unsigned long long>(r.instructions)
+            , r.instructions == 0 ? 0.0 : static_cast<double>(r.cycles) / static_cast<double>(r.instructions)
+            , r.pc, static_cast<unsigned long long>(r.stateHash), outcomes[static_cast<std::size_t>(r.outcome)]
+        );
+
+        const auto [first, last] = byParent.equal_range(r.node);
+
+        for (auto it = first; it != last; ++it)
+            self(self, *it->second, depth + 1);
+    };
+
+    for (const Record& r : records) {
+        if (!isNode(r.parent))
+            print(print, r, 0);
+    }
+}
+
+#if SPIMDF_FORK
+
+CheckpointTree::CheckpointTree() {
+    int fds[2];
+
+    if (pipe(fds) != 0)
+        throw std::runtime_error(std::string("Cannot make the checkpoint pipe: ") + std::strerror(errno));
+
+    readFd = fds[0];
+    writeFd = fds[1];
+}
+
+CheckpointTree::~CheckpointTree() {
+    if (readFd >= 0)
+        close(readFd);
+
+    if (writeFd >= 0)
+        close(writeFd);
+}
+
+void CheckpointTree::Explore(
+      CPU& caller, std::string_view label, const Variant& variant, uint64_t maxCycles, const PipelineConfig* config
+) {
+    fflush(nullptr); // Otherwise anything still buffered would be written again by the child
+
+    const pid_t pid = fork();
+
+    if (pid < 0)
+        throw std::runtime_error(std::string("Cannot fork a checkpoint: ") + std::strerror(errno));
+
+    if (pid != 0) {
+        children.push_back(pid);
+        return;
+    }
+
+    // Child. Never returns to the caller, whose stack it shares a copy of.
+    close(readFd);
+    readFd = -1;
+    children.clear();
+
+    Record record{};
+    record.node = getpid();
+    record.parent = getppid();
+    record.checkpointCycle = caller.GetCycle();
+    label.copy(record.label.data(), std::min(label.size(), record.label.size() - 1));
+
+    const uint64_t startFetched = caller.executors.fetch.fetched;
+    std::unique_ptr<CPU> reconfigured; // Only with a config
+    CPU* current = &caller;            // The CPU the child runs on
+
+    try {
+        if (config != nullptr) {
+            reconfigured = std::make_unique<CPU>(caller.Reconfigured(*config));
+            current = reconfigured.get();
+        }
+
+        CPU& cpu = *current;
+        const FetchExec& fetch = cpu.executors.fetch;
+
+        variant(cpu, *this);
+
+        while (!fetch.isBroken && cpu.GetCycle() - record.checkpointCycle < maxCycles)
+            cpu.Clock();
+
+        record.outcome = fetch.isBroken ? Outcome::Finished : Outcome::Limit;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "What-if run %s failed: %s\n", record.label.data(), e.what());
+        record.outcome = Outcome::Failed;
+    }
+
+    record.cycles = current->GetCycle() - record.checkpointCycle;
+    record.instructions = current->executors.fetch.fetched - startFetched;
+    record.pc = current->GetPC();
+    record.stateHash = HashState(*current);
+
+    while (write(writeFd, &record, sizeof(record)) < 0 && errno == EINTR)
+        ;
+
+    for (const int child : children)
+        waitpid(child, nullptr, 0);
+
+    fflush(nullptr);
+    _exit(record.outcome == Outcome::Failed ? 1 : 0); // Skips destructors and atexit handlers meant for the caller
+}
+
+std::vector<CheckpointTree::Record> CheckpointTree::Collect() {
+    // The pipe reads end of file once every process that could write to it is gone, this one included
+    close(writeFd);
+    writeFd = -1;
+
+    std::vector<Record> records;
+    Record record;
+    std::size_t got = 0;
+
+    while (true) {
+        const ssize_t n = read(readFd, reinterpret_cast<char*>(&record) + got, sizeof(record) - got);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            break;
+
+        got += static_cast<std::size_t>(n);
+
+        if (got == sizeof(record)) {
+            records.push_back(record);
+            got = 0;
+        }
+    }
+
+    for (const int child : children)
+        waitpid(child, nullptr, 0);
+
+    children.clear();
+    return records;
+}
+
+#else
+
+CheckpointTree::CheckpointTree() {
+    throw std::runtime_error("What-if checkpoints need fork(), which this host does not have");
+}
+
+CheckpointTree::~CheckpointTree() { }
+
+void CheckpointTree::Explore(CPU&, std::string_view, const Variant&, uint64_t, const PipelineConfig*) { }
+
+std::vector<CheckpointTree::Record> CheckpointTree::Collect() {
+    return {};
+}
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if __has_include(<unistd.h>) && __has_include(<sys/wait.h>)
+    #define SPIMDF_FORK 1
+#else
+    #define SPIMDF_FORK 0
+#endif
+
+namespace SPIMDF {
+    class CPU;
+    struct PipelineConfig;
+
+    // One change to a what-if run: "R<reg>=<value>" or "M<address>=<value>" for the architectural state, or
+    // "<key>=<value>" for a pipeline parameter (see PipelineConfig::Set)
+    struct StateEdit {
+        enum class Kind : uint8_t { Register, Memory, Pipeline };
+
+        Kind kind = Kind::Register;
+        uint32_t target = 0;
+        int32_t value = 0;
+        std::string assignment; // Pipeline edits only
+
+        // Register and memory edits change the CPU, pipeline edits the config; each ignores the other kind
+        void Apply(CPU& cpu) const;
+        void Apply(PipelineConfig& config) const;
+
+        // Parses a comma-separated list of edits. Throws std::invalid_argument on a malformed one.
+        static std::vector<StateEdit> ParseList(std::string_view list);
+    };
+
+    // What-if exploration with fork(). Explore() forks the process: the child gets the CPU as it stands,
+    // copy-on-write, applies a variant to it and runs on to BREAK, while the caller's CPU is left as it was
+    // and the caller carries on. Nothing is serialised, so a checkpoint costs one fork. A variant can
+    // explore further from its own state, so the runs form a tree; every process in it reports through
+    // one pipe to the process that made the tree.
+    class CheckpointTree {
+        public:
+        static constexpr bool Available = SPIMDF_FORK;
+
+        enum class Outcome : uint8_t {
+              Finished // Reached BREAK
+            , Limit    // Still running after maxCycles
+            , Failed   // The variant threw
+        };
+
+        // Sent once per variant. Small enough that each write to the pipe is atomic.
+        struct Record {
+            int32_t node;   // Process that ran the variant
+            int32_t parent; // Process it was forked from
+            uint64_t checkpointCycle;
+            uint64_t cycles;       // From the checkpoint to the end of the run
+            uint64_t instructions; // Fetched in that time
+            uint64_t stateHash;    // Of the registers and memory at the end, to tell outcomes apart
+            uint32_t pc;
+            Outcome outcome;
+            std::array<char, 51> label; // Null-terminated, truncated if need be
+        };
+
+        static_assert(sizeof(Record) == 96);
+
+        // The child's CPU, and the tree to explore further from it
+        using Variant = std::function<void(CPU& cpu, CheckpointTree& tree)>;
+
+        // Throws std::runtime_error if the host cannot fork or the pipe cannot be made
+        CheckpointTree();
+        ~CheckpointTree();
+
+        CheckpointTree(const CheckpointTree&) = delete;
+        CheckpointTree& operator=(const CheckpointTree&) = delete;
+
+        // Only returns in the caller. The child applies variant, clocks until BREAK or maxCycles after the
+        // checkpoint, sends its Record, waits for any children of its own and exits. Throws
+        // std::runtime_error if the fork fails.
+        // With a config, the child first moves to a CPU with that pipeline geometry (see CPU::Reconfigured),
+        // so variant and the rest of the run see the new pipeline.
+        void Explore(
+              CPU& cpu, std::string_view label, const Variant& variant, uint64_t maxCycles = UINT64_MAX
+            , const PipelineConfig* config = nullptr
+        );
+
+        // Waits until every process in the tree has exited and returns their records in arrival order.
+        // Only for the process that made the tree, and nothing can be explored afterwards.
+        std::vector<Record> Collect();
+
+        // One line per record, indented under the record of the process it was forked from
+        static void Print(const std::vector<Record>& records, std::FILE* out);
+
+        private:
+        int readFd = -1;
+        int writeFd = -1;
+        std::vector<int> children; // Forked by this process
+    };
+}
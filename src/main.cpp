@@ -1,20 +1,145 @@
 #include "CPU.hpp"
 #include <cstdio>
 #include "Disassembler.hpp"
+#include "Functional.hpp"
+#include "Image.hpp"
+#include "IntervalSim.hpp"
 #include "ISA.hpp"
+#include "PipelineConfig.hpp"
+#include "ProgramCache.hpp"
+#include "Sampling.hpp"
+#include "SimPoint.hpp"
+#include "Snapshot.hpp"
+#include "Stats.hpp"
+#include "Trace.hpp"
+#include "WhatIf.hpp"
 #include "Instruction.hpp"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
-
-#include "opt_array.hpp"
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace SPIMDF;
 
 
-int main(int argc, const char** argv) {
-    CPU cpu(256);
-    SPIMDF::Disassemble("sample.txt", cpu);
+// Everything main() does. Errors in the arguments or input files come out as exceptions.
+int Simulate(int argc, const char** argv) {
+    // MIPSsim --convert <program.txt> <program.img>
+    if (argc == 4 && strcmp(argv[1], "--convert") == 0) {
+        Image::Convert(argv[2], argv[3]);
+        return 0;
+    }
+
+    // MIPSsim [--no-listing] [--lazy-decode] [--threads N] [--cache DIR] [--stats]
+    //         [--config FILE] [--pipeline key=value]... [--event-driven] [--fast-forward N] [--jit]
+    //         [--sample PERIOD [--sample-warmup N] [--sample-window N]]
+    //         [--simpoint-profile POINTS [--interval N] [--clusters K]] [--simpoint-run POINTS [--sample-warmup N]]
+    //         [--parallel-intervals N [--threads N] [--sample-warmup N]]
+    //         [--snapshot-at CYCLE SNAPSHOT] [--restore SNAPSHOT] [--what-if CYCLE [--variant EDITS]... [--variant-cycles N]]
+    //         [program.txt | program.img]
+    const char* input = "sample.txt";
+    const char* listing = "disassembly.txt"; // Not written for images, snapshots or --lazy-decode
+    const char* cacheDir = nullptr;
+    bool lazyDecode = false;
+    bool printStats = false;
+    bool eventDriven = false;
+    bool useJit = false;
+    unsigned threads = 1;
+    uint64_t fastForward = 0;
+    SamplingConfig sampling;
+    bool sample = false;
+    SimPoint::Config simPoint;
+    const char* simPointProfile = nullptr;
+    const char* simPointRun = nullptr;
+    uint64_t parallelInterval = 0;
+    uint64_t snapshotAt = 0;
+    const char* snapshotFile = nullptr;
+    const char* restoreFile = nullptr;
+    uint64_t whatIfAt = 0;
+    bool whatIfPending = false;
+    uint64_t variantCycles = 1000000; // A changed input can easily leave the program looping forever
+    std::vector<std::pair<std::string, std::vector<StateEdit>>> variants = { { "baseline", {} } };
+    PipelineConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-listing") == 0)
+            listing = nullptr;
+        else if (strcmp(argv[i], "--listing") == 0)
+            listing = "disassembly.txt";
+        else if (strcmp(argv[i], "--lazy-decode") == 0)
+            lazyDecode = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cacheDir = argv[++i];
+        else if (strcmp(argv[i], "--stats") == 0)
+            printStats = true;
+        else if (strcmp(argv[i], "--event-driven") == 0)
+            eventDriven = true;
+        else if (strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc)
+            fastForward = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--jit") == 0)
+            useJit = true;
+        else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+            sample = true;
+            sampling.period = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--sample-warmup") == 0 && i + 1 < argc)
+            sampling.warmup = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--sample-window") == 0 && i + 1 < argc)
+            sampling.window = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--simpoint-profile") == 0 && i + 1 < argc)
+            simPointProfile = argv[++i];
+        else if (strcmp(argv[i], "--simpoint-run") == 0 && i + 1 < argc)
+            simPointRun = argv[++i];
+        else if (strcmp(argv[i], "--parallel-intervals") == 0 && i + 1 < argc)
+            parallelInterval = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--snapshot-at") == 0 && i + 2 < argc) {
+            snapshotAt = std::stoull(argv[++i]);
+            snapshotFile = argv[++i];
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc)
+            restoreFile = argv[++i];
+        else if (strcmp(argv[i], "--what-if") == 0 && i + 1 < argc) {
+            whatIfAt = std::stoull(argv[++i]);
+            whatIfPending = true;
+        } else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            variants.emplace_back(argv[i + 1], StateEdit::ParseList(argv[i + 1]));
+            i++;
+        } else if (strcmp(argv[i], "--variant-cycles") == 0 && i + 1 < argc)
+            variantCycles = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+            simPoint.interval = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--clusters") == 0 && i + 1 < argc)
+            simPoint.clusters = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+            config.Load(argv[++i]);
+        else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+            config.Set(argv[++i]);
+        else
+            input = argv[i];
+    }
+
+    // A snapshot brings its own program and pipeline geometry
+    CPU cpu = restoreFile != nullptr ? Snapshot::Load(restoreFile) : CPU(256, config);
+    RunStats stats;
+
+    if (restoreFile == nullptr) {
+        if (Image::IsImage(input))
+            Image::Load(input, cpu);
+        else if (cacheDir != nullptr)
+            ProgramCache(cacheDir).Load(input, cpu, stats, listing);
+        else if (lazyDecode)
+            SPIMDF::LoadLazy(input, cpu);
+        else if (threads != 1)
+            SPIMDF::DisassembleParallel(input, cpu, threads, listing);
+        else
+            SPIMDF::Disassemble(input, cpu, listing);
+    }
     // cpu.Mem(200) = 44;
 
     // uint32_t ia = 252;
@@ -80,99 +205,120 @@ int main(int argc, const char** argv) {
     // cpu.Reg(5) = 200;
 
 
-    std::ofstream output("simulation.txt", std::ios::binary);
-    // auto& output = std::cout;
+    // Sampling only estimates the timing, so there is no trace
+    if (sample) {
+        sampling.useJit = useJit;
+        RunSampled(cpu, sampling).Print(stdout);
+        return 0;
+    }
 
-    char buffer[200];
-    std::string temp;
+    if (simPointProfile != nullptr) {
+        simPoint.useJit = useJit;
 
-    bool hitBreak = false;
+        const SimPoint::Points points = SimPoint::Profile(cpu, simPoint);
+        points.Save(simPointProfile);
+        printf(
+            "%zu simulation points over %llu instructions written to %s\n"
+            , points.points.size(), static_cast<unsigned long long>(points.instructions), simPointProfile
+        );
+        return 0;
+    }
 
-    while (true) {
-        output << "--------------------\n";
-        
-        // sprintf(buffer, "Cycle %lu:\t%u\t%s\n\n", cpu.GetCycle(), cpu.GetPC(), cpu.CurInstr().ToString().c_str());
-        sprintf(buffer, "Cycle %lu:\n\n", cpu.GetCycle());
-        output << buffer;
+    if (simPointRun != nullptr) {
+        SimPoint::Simulate(cpu, SimPoint::Points::Load(simPointRun), sampling.warmup, useJit).Print(stdout);
+        return 0;
+    }
 
-        // hitBreak = cpu.CurInstr().opcode == ISA::Opcode::BRK;
+    if (parallelInterval != 0) {
+        IntervalConfig intervals;
+        intervals.interval = parallelInterval;
+        intervals.warmup = sampling.warmup;
+        intervals.threads = threads;
+        intervals.useJit = useJit;
 
-        cpu.Clock();
+        RunIntervals(cpu, intervals).Print(stdout);
+        return 0;
+    }
 
-        // Execution Units
-        output << "IF Unit:\n";
-        if (cpu.executors.fetch.staller.IsNop())
-            output << "\tWaiting Instruction:\n"; 
-        else
-            output << "\tWaiting Instruction: [" << cpu.executors.fetch.staller.ToString() << "]\n";
+    std::optional<CheckpointTree> whatIf;
 
-        if (cpu.executors.fetch.executed.IsNop())
-            output << "\tExecuted Instruction:\n";
-        else
-            output << "\tExecuted Instruction: [" << cpu.executors.fetch.executed.ToString() << "]\n";
-
-        // Pre-Issue Queue
-        output << "Pre-Issue Queue:\n";
-        output << cpu.queues.preIssue.ToPrintingString();
-
-        // Pre-MemALU Queue
-        output << "Pre-ALU1 Queue:\n";
-        output << cpu.queues.preMemALU.ToPrintingString();
-
-        // Pre-Mem Queue
-        output << "Pre-MEM Queue:";
-        output << cpu.queues.preMem.ToPrintingString() << '\n';
-
-        // Post-Mem Queue
-        output << "Post-MEM Queue:";
-        output << cpu.queues.postMem.ToPrintingString() << '\n';
-
-        // Pre-ALU Queue
-        output << "Pre-ALU2 Queue:\n";
-        output << cpu.queues.preALU.ToPrintingString();
-
-        // Post-ALU Queue
-        output << "Post-ALU2 Queue:";
-        output << cpu.queues.postALU.ToPrintingString() << '\n';
-
-        // Print registers
-        uint8_t base = 0;
-        output << "\nRegisters\n";
-
-        for (uint8_t row = 0; row < 4; row++) {
-            sprintf(
-                buffer
-                , "R%02u:\t%i\t%i\t%i\t%i\t%i\t%i\t%i\t%i\n"
-                , base
-                , cpu.Reg(base + 0), cpu.Reg(base + 1), cpu.Reg(base + 2), cpu.Reg(base + 3)
-                , cpu.Reg(base + 4), cpu.Reg(base + 5), cpu.Reg(base + 6), cpu.Reg(base + 7)
+    if (whatIfPending)
+        whatIf.emplace();
+
+    std::ofstream output("simulation.txt", std::ios::binary);
+    // auto& output = std::cout;
+
+    // Run the first instructions without the timing model; the trace starts where the pipeline takes over
+    bool finished = false;
+
+    if (fastForward != 0) {
+        FunctionalEngine engine(cpu);
+
+        if (useJit && !engine.EnableJit())
+            fprintf(stderr, "No JIT for this host, fast-forwarding with the interpreter\n");
+
+        stats.fastForwarded = engine.Run(fastForward);
+        stats.compiledBlocks = engine.GetCompiledBlocks();
+        finished = engine.IsHalted();
+        cpu.ResetPipeline();
+
+        if (finished)
+            fprintf(
+                stderr, "Program reached BREAK after %llu fast-forwarded instructions\n"
+                , static_cast<unsigned long long>(stats.fastForwarded)
             );
+    }
 
-            output << buffer;
+    while (!finished) {
+        uint64_t cycle = cpu.GetCycle();
 
-            base += 8;
-        }
+        if (eventDriven) {
+            const uint64_t next = cpu.NextEventCycle();
 
-        // Print memory
-        uint8_t word = 0;
-        output << "\nData\n";
-
-        for (auto [addr, datum] : cpu.GetAllMem()) {
-            if (word == 0)
-                output << addr << ":\t";
-            
-            output << datum;
-
-            if (word++ != 7)
-                output << "\t";
-            else {
-                word = 0;
-                output << "\n";
+            if (next == CPU::Never) {
+                fprintf(stderr, "Pipeline deadlocked at cycle %llu\n", static_cast<unsigned long long>(cycle));
+                break;
             }
+
+            // Nothing changes until next, so every skipped cycle's record is the current state
+            for (; cycle < next; cycle++)
+                WriteCycleTrace(output, cpu, cycle);
+
+            cpu.SkipTo(next);
         }
 
+        cpu.Clock();
+
+        WriteCycleTrace(output, cpu, cycle);
         output << std::flush;
 
+        // Taken after the cycle's record, so a run restored from it continues the trace with the next cycle
+        if (snapshotFile != nullptr && cycle >= snapshotAt) {
+            Snapshot::Save(cpu, snapshotFile);
+            snapshotFile = nullptr;
+        }
+
+        // Each variant runs on from this cycle in a forked copy of the simulator; this run and its trace carry on
+        if (whatIfPending && cycle >= whatIfAt) {
+            for (const auto& [label, edits] : variants) {
+                PipelineConfig variantConfig = cpu.config;
+
+                for (const StateEdit& edit : edits)
+                    edit.Apply(variantConfig);
+
+                const bool reconfigure = std::any_of(edits.begin(), edits.end(), [](const StateEdit& edit) {
+                    return edit.kind == StateEdit::Kind::Pipeline;
+                });
+
+                whatIf->Explore(cpu, label, [&edits](CPU& copy, CheckpointTree&) {
+                    for (const StateEdit& edit : edits)
+                        edit.Apply(copy);
+                }, variantCycles, reconfigure ? &variantConfig : nullptr);
+            }
+
+            whatIfPending = false;
+        }
+
         if (cpu.executors.fetch.isBroken) break;
 
         // if (argc != 2 || strcmp(argv[1], "DEBUG") != 0)
@@ -180,6 +326,27 @@ int main(int argc, const char** argv) {
     }
 
     output.close();
+
+    if (whatIf.has_value())
+        CheckpointTree::Print(whatIf->Collect(), stdout);
+
+    if (printStats) {
+        stats.stageCalls = cpu.GetStageCalls();
+        stats.stageSkips = cpu.GetStageSkips();
+        stats.skippedCycles = cpu.GetSkippedCycles();
+        stats.Print(stderr);
+    }
+
+    return 0;
+}
+
+int main(int argc, const char** argv) {
+    try {
+        return Simulate(argc, argv);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
 }
 
 // if (a.is_empty()) printf("Is empty\n");
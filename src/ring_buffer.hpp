@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+// Bounded FIFO. Elements are stored in a circular array with a head index and an occupancy count,
+// so push_back, pop_front and the size queries are all O(1). Iteration is in queue order, front first.
+// Storage is always N elements, so index wrapping stays a compile-time constant; the usable capacity
+// can be lowered at run time with set_capacity().
+template<typename T, int N>
+class ring_buffer {
+    static_assert(N > 0);
+
+    std::array<T, N> storage{};
+    std::size_t head = 0; // Physical index of the front element
+    std::size_t count = 0;
+    std::size_t limit = N;
+
+    static constexpr std::size_t wrap(std::size_t i) {
+        return i >= N ? i - N : i;
+    }
+
+    std::size_t physical(std::size_t logical) const {
+        return wrap(head + logical);
+    }
+
+    template<typename Buffer_t, typename Value_t>
+    class basic_iterator {
+        friend class ring_buffer;
+
+        Buffer_t* buffer = nullptr;
+        std::size_t index = 0; // Logical index
+
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value_t*;
+        using reference = Value_t&;
+
+        basic_iterator() = default;
+        basic_iterator(Buffer_t* buffer, std::size_t index) : buffer(buffer), index(index) { };
+
+        reference operator*() const { return (*buffer)[index]; };
+        pointer operator->() const { return &(*buffer)[index]; };
+
+        basic_iterator& operator++() { index++; return *this; };
+        basic_iterator operator++(int) { auto copy = *this; index++; return copy; };
+
+        bool operator==(const basic_iterator& other) const { return index == other.index; };
+        bool operator!=(const basic_iterator& other) const { return index != other.index; };
+    };
+
+    public:
+    using iterator = basic_iterator<ring_buffer, T>;
+    using const_iterator = basic_iterator<const ring_buffer, const T>;
+
+    static constexpr std::size_t max_capacity() { return N; };
+    std::size_t capacity() const { return limit; };
+
+    // Buffer must be empty. cap must be in [1, N].
+    void set_capacity(std::size_t cap) {
+        limit = cap;
+    }
+
+    T& operator[](std::size_t logical) { return storage[physical(logical)]; };
+    const T& operator[](std::size_t logical) const { return storage[physical(logical)]; };
+
+    iterator begin() { return iterator(this, 0); };
+    iterator end() { return iterator(this, count); };
+    const_iterator begin() const { return const_iterator(this, 0); };
+    const_iterator end() const { return const_iterator(this, count); };
+
+    // Returns false, leaving the buffer unchanged, if there is no room
+    bool push_back(T&& o) {
+        if (is_full())
+            return false;
+
+        storage[physical(count)] = std::move(o);
+        count++;
+        return true;
+    }
+
+    // Returns false, leaving the buffer unchanged, if there is no room
+    bool push_front(T&& o) {
+        if (is_full())
+            return false;
+
+        head = wrap(head + N - 1);
+        storage[head] = std::move(o);
+        count++;
+        return true;
+    }
+
+    // Buffer must not be empty
+    T pop_front() {
+        T popped = std::move(storage[head]);
+
+        head = wrap(head + 1);
+        count--;
+        return popped;
+    }
+
+    // Buffer must not be empty
+    T pop_back() {
+        count--;
+        return std::move(storage[physical(count)]);
+    }
+
+    // Removes the element at logical index pos, keeping the order of the remaining elements
+    T pull(std::size_t pos) {
+        T pulled = std::move((*this)[pos]);
+
+        // Shift whichever side of pos is shorter into the gap
+        if (pos < count / 2) {
+            for (std::size_t i = pos; i > 0; i--)
+                (*this)[i] = std::move((*this)[i - 1]);
+
+            head = wrap(head + 1);
+        } else {
+            for (std::size_t i = pos; i + 1 < count; i++)
+                (*this)[i] = std::move((*this)[i + 1]);
+        }
+
+        count--;
+        return pulled;
+    }
+
+    T pull(const iterator& pos) {
+        return pull(pos.index);
+    }
+
+    void remove(const iterator& pos) {
+        pull(pos);
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    bool is_empty() const {
+        return count == 0;
+    }
+
+    bool is_full() const {
+        return count == limit;
+    }
+
+    std::size_t num_empty() const {
+        return limit - count;
+    }
+};
@@ -0,0 +1,49 @@
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace SPIMDF;
+
+// Measures how fast CPU::Clock() runs the pipeline: loads a program, clocks it to BREAK with no trace,
+// and reports the best of several runs in millions of cycles per second.
+//
+// ClockBench [--runs N] [program.txt]
+// tools/loop.txt is a 60000-iteration ALU/memory loop: 240004 instructions, 390005 cycles.
+
+int main(int argc, const char** argv) {
+    const char* input = "tools/loop.txt";
+    unsigned runs = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = static_cast<unsigned>(std::stoul(argv[++i]));
+        else
+            input = argv[i];
+    }
+
+    double best = 0;
+    uint64_t cycles = 0;
+
+    for (unsigned run = 0; run < runs; run++) {
+        auto cpu = std::make_unique<CPU>(256);
+        Disassemble(input, *cpu);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        while (!cpu->executors.fetch.isBroken)
+            cpu->Clock();
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        cycles = cpu->GetCycle() - 1;
+        best = std::max(best, cycles / elapsed.count() / 1e6);
+    }
+
+    printf("%s: %llu cycles, best of %u runs: %.1f Mcycles/s\n", input, static_cast<unsigned long long>(cycles), runs, best);
+    return 0;
+}
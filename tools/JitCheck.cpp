@@ -0,0 +1,175 @@
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include "Functional.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace SPIMDF;
+
+// Differential check of the JIT against the executors: runs random programs through FunctionalEngine::Run()
+// with every block compiled on its first run, and through FunctionalEngine::Step(), and compares the
+// architectural state after the same number of instructions.
+//
+// JitCheck [--programs N] [--seed S] [--instrs N]
+// Exits with 1 on the first mismatch, printing the seed that reproduces it.
+
+namespace {
+    constexpr uint32_t TextBase = 256;
+    constexpr uint32_t ProgramLength = 60;
+
+    // Category 1 and 2 encodings, see ISA.hpp
+    uint32_t Cat1(uint32_t op, uint32_t fields) { return 0b01u << 30 | op << 26 | fields; }
+    uint32_t Cat2(uint32_t op, uint32_t fields) { return 0b11u << 30 | op << 26 | fields; }
+
+    uint32_t RFields(uint32_t rs, uint32_t rt, uint32_t rd, uint32_t sa = 0, uint32_t func = 0) {
+        return rs << 21 | rt << 16 | rd << 11 | sa << 6 | func;
+    }
+
+    uint32_t IFields(uint32_t rs, uint32_t rt, int32_t imm) {
+        return rs << 21 | rt << 16 | (static_cast<uint32_t>(imm) & 0xFFFF);
+    }
+
+    // A straight mix of ALU, shift and memory instructions with branches and jumps anywhere in the program,
+    // so blocks are entered midway, fall through, loop and leave through JR. Ends in NOP, BREAK and some data.
+    std::vector<uint32_t> RandomProgram(std::mt19937& rng) {
+        auto reg = [&rng]() { return static_cast<uint32_t>(rng() % 32); };
+        auto range = [&rng](int32_t lo, int32_t hi) { return lo + static_cast<int32_t>(rng() % (hi - lo)); };
+        auto target = [&rng]() { return TextBase + 4 * static_cast<uint32_t>(rng() % ProgramLength); };
+
+        std::vector<uint32_t> words;
+
+        for (uint32_t i = 0; i < ProgramLength; i++) {
+            const uint32_t kind = rng() % 100;
+
+            if (kind < 45) // ADD .. SLT
+                words.push_back(Cat2(rng() % 8, RFields(reg(), reg(), reg())));
+            else if (kind < 70) // ADDI .. XORI
+                words.push_back(Cat2(8 + rng() % 4, IFields(reg(), reg(), range(-32768, 32768))));
+            else if (kind < 78) // SLL, SRL, SRA
+                words.push_back(Cat1(8 + rng() % 3, RFields(0, reg(), reg(), rng() % 32)));
+            else if (kind < 86) // SW, LW
+                words.push_back(Cat1(6 + rng() % 2, IFields(reg(), reg(), range(-64, 64))));
+            else if (kind < 94) { // BEQ, BLTZ, BGTZ
+                const uint32_t op = 2 + rng() % 3;
+                const int32_t offset = range(-static_cast<int32_t>(i), static_cast<int32_t>(ProgramLength - i));
+
+                words.push_back(Cat1(op, IFields(reg(), op == 2 ? reg() : 0, offset)));
+            } else if (kind < 97) // J
+                words.push_back(Cat1(0, target() >> 2));
+            else { // ADDI r31, r0, target; JR r31
+                words.push_back(Cat2(8, IFields(0, 31, static_cast<int32_t>(target()))));
+                words.push_back(Cat1(1, RFields(31, 0, 0, 0, 8)));
+            }
+        }
+
+        words.push_back(Cat1(11, 0)); // NOP
+        words.push_back(Cat1(5, 0));  // BREAK
+
+        for (int i = 0; i < 8; i++)
+            words.push_back(rng());
+
+        return words;
+    }
+
+    void Load(CPU& cpu, const std::vector<uint32_t>& words) {
+        uint32_t addr = TextBase;
+        bool inText = true;
+
+        for (uint32_t word : words) {
+            if (inText) {
+                const Instruction instr = DecodeMachineCode(word);
+                cpu.LoadInstr(addr, instr);
+                inText = instr.opcode != ISA::Opcode::BRK;
+            } else
+                cpu.LoadMem(addr, static_cast<int32_t>(word));
+
+            addr += 4;
+        }
+    }
+
+    bool SameState(const CPU& a, const CPU& b) {
+        for (uint8_t r = 0; r < 32; r++) {
+            if (a.Reg(r) != b.Reg(r))
+                return false;
+        }
+
+        return a.GetPC() == b.GetPC() && a.GetAllMem() == b.GetAllMem();
+    }
+
+    // Returns false on a mismatch. Random programs can loop forever, so each runs at most maxInstrs instructions.
+    bool CheckProgram(uint32_t seed, uint64_t maxInstrs) {
+        std::mt19937 rng(seed);
+        const std::vector<uint32_t> words = RandomProgram(rng);
+
+        auto jitCPU = std::make_unique<CPU>(TextBase);
+        auto stepCPU = std::make_unique<CPU>(TextBase);
+        Load(*jitCPU, words);
+        Load(*stepCPU, words);
+
+        // Mostly small values, so branches and memory addresses land nearby
+        for (uint8_t r = 0; r < 32; r++) {
+            const int32_t value = rng() % 4 == 0 ? static_cast<int32_t>(rng()) : static_cast<int32_t>(rng() % 200) - 50;
+            jitCPU->Reg(r) = value;
+            stepCPU->Reg(r) = value;
+        }
+
+        FunctionalEngine jit(*jitCPU);
+        FunctionalEngine step(*stepCPU);
+        jit.EnableJit(1);
+
+        // Run in uneven slices, so blocks are also cut short and finished one instruction at a time
+        while (jit.GetRetired() < maxInstrs && !jit.IsHalted()) {
+            const uint64_t slice = std::min<uint64_t>(maxInstrs - jit.GetRetired(), 1 + rng() % 400);
+            const uint64_t ran = jit.Run(slice);
+
+            while (step.GetRetired() < jit.GetRetired() && step.Step())
+                ;
+
+            if (step.GetRetired() != jit.GetRetired() || step.IsHalted() != jit.IsHalted() || !SameState(*jitCPU, *stepCPU)) {
+                printf(
+                    "Mismatch in program %u after %llu instructions: PC %u (JIT) vs %u (executors)\n"
+                    , seed, static_cast<unsigned long long>(jit.GetRetired()), jitCPU->GetPC(), stepCPU->GetPC()
+                );
+                return false;
+            }
+
+            if (ran == 0)
+                break;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, const char** argv) {
+    uint32_t programs = 1000;
+    uint32_t seed = 1;
+    uint64_t maxInstrs = 3000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--programs") == 0 && i + 1 < argc)
+            programs = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (strcmp(argv[i], "--instrs") == 0 && i + 1 < argc)
+            maxInstrs = std::stoull(argv[++i]);
+    }
+
+    if (!JitCompiler::Available) {
+        printf("No JIT for this host, nothing to check\n");
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < programs; i++) {
+        if (!CheckProgram(seed + i, maxInstrs))
+            return 1;
+    }
+
+    printf("%u programs matched\n", programs);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace SPIMDF;
+
+// Checks that skipping idle stages never changes timing: runs each program under several stage orders, once
+// through PipelineOrder (which skips stages without work) and once with every stage called every cycle, and
+// compares the PC, registers and queue occupancy after every cycle.
+//
+// OrderCheck [program.txt]...
+// Exits with 1 on the first difference.
+
+namespace {
+    // Same cycle as PipelineOrder, minus the skipping
+    template<auto... StagePtrs>
+    struct UnskippedOrder {
+        static constexpr std::size_t NumStages = sizeof...(StagePtrs);
+
+        static std::size_t Cycle(CPU& cpu) {
+            ((cpu.executors.*StagePtrs).Consume(cpu), ...);
+            ((cpu.executors.*StagePtrs).Produce(cpu), ...);
+            return NumStages;
+        }
+    };
+
+    constexpr auto Fetch = &CPU::Stages::fetch;
+    constexpr auto Issue = &CPU::Stages::issue;
+    constexpr auto ALU = &CPU::Stages::alu;
+    constexpr auto MemALU = &CPU::Stages::memALU;
+    constexpr auto Mem = &CPU::Stages::mem;
+    constexpr auto Writeback = &CPU::Stages::writeback;
+
+    constexpr uint64_t MaxCycles = 5000000;
+
+    bool SameState(const CPU& a, const CPU& b) {
+        for (uint8_t r = 0; r < 32; r++) {
+            if (a.Reg(r) != b.Reg(r))
+                return false;
+        }
+
+        return a.GetPC() == b.GetPC()
+            && a.queues.preIssue.entries.size() == b.queues.preIssue.entries.size()
+            && a.queues.preALU.entries.size() == b.queues.preALU.entries.size()
+            && a.queues.postALU.entries.size() == b.queues.postALU.entries.size()
+            && a.queues.preMemALU.entries.size() == b.queues.preMemALU.entries.size()
+            && a.queues.preMem.entries.size() == b.queues.preMem.entries.size()
+            && a.queues.postMem.entries.size() == b.queues.postMem.entries.size();
+    }
+
+    template<auto... StagePtrs>
+    bool CheckOrder(const char* filename, const char* orderName) {
+        auto skipping = std::make_unique<CPU>(256);
+        auto unskipped = std::make_unique<CPU>(256);
+        Disassemble(filename, *skipping);
+        Disassemble(filename, *unskipped);
+
+        while (skipping->GetCycle() < MaxCycles) {
+            skipping->Clock<PipelineOrder<StagePtrs...>>();
+            unskipped->Clock<UnskippedOrder<StagePtrs...>>();
+
+            if (!SameState(*skipping, *unskipped) || skipping->executors.fetch.isBroken != unskipped->executors.fetch.isBroken) {
+                printf(
+                    "%s, %s order: skipping idle stages changed the state in cycle %llu\n"
+                    , filename, orderName, static_cast<unsigned long long>(skipping->GetCycle() - 1)
+                );
+                return false;
+            }
+
+            if (skipping->executors.fetch.isBroken)
+                break;
+        }
+
+        if (skipping->GetAllMem() != unskipped->GetAllMem()) {
+            printf("%s, %s order: skipping idle stages changed memory\n", filename, orderName);
+            return false;
+        }
+
+        printf(
+            "%s, %s order: %llu cycles, %llu of %llu stage calls skipped\n"
+            , filename, orderName, static_cast<unsigned long long>(skipping->GetCycle() - 1)
+            , static_cast<unsigned long long>(skipping->GetStageSkips())
+            , static_cast<unsigned long long>(skipping->GetStageCalls())
+        );
+        return true;
+    }
+}
+
+int main(int argc, const char** argv) {
+    std::vector<const char*> programs(argv + 1, argv + argc);
+
+    if (programs.empty())
+        programs = { "sample.txt", "tools/loop.txt" };
+
+    for (const char* program : programs) {
+        const bool ok = CheckOrder<Fetch, Issue, ALU, MemALU, Mem, Writeback>(program, "default")
+            && CheckOrder<Issue, Fetch, ALU, MemALU, Mem, Writeback>(program, "issue-first")
+            && CheckOrder<Writeback, Mem, MemALU, ALU, Issue, Fetch>(program, "reversed")
+            && CheckOrder<ALU, Writeback, Fetch, Mem, Issue, MemALU>(program, "shuffled");
+
+        if (!ok)
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "Buffer.hpp"
+#include "ring_buffer.hpp"
+#include "opt_array.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+using namespace SPIMDF;
+
+// Times the pipeline queue operations on ring_buffer against opt_array, the container it replaced (kept in
+// tools/ for this comparison only), with the post-ALU queue's entry type. Each round fills an empty queue
+// and empties it again one way or another, so both containers do the same work. Results are the best of
+// several runs, in nanoseconds per queue operation.
+//
+// QueueBench [--rounds N] [--runs N]
+
+namespace {
+    using Entry = BufferEntry::PostALU;
+
+    volatile int64_t sink; // Every checksum ends up here, so the work cannot be optimised away
+
+    template<typename Queue>
+    void Clear(Queue& queue) {
+        if constexpr (requires { queue.clear(); })
+            queue.clear();
+        else
+            queue.fill(std::nullopt);
+    }
+
+    // Returns the number of entries pushed
+    template<typename Queue>
+    int Fill(Queue& queue, uint64_t round) {
+        int pushed = 0;
+
+        for (; !queue.is_full(); pushed++)
+            queue.push_back(Entry{ Instruction(), static_cast<int32_t>(round) + pushed });
+
+        return pushed;
+    }
+
+    // push_back until full, then clear
+    template<typename Queue>
+    int64_t PushBack(Queue& queue, uint64_t round) {
+        const int pushed = Fill(queue, round);
+        const int64_t sum = queue.is_full() + pushed;
+
+        Clear(queue);
+        return sum;
+    }
+
+    // push_back until full, then pop_front until empty
+    template<typename Queue>
+    int64_t PopFront(Queue& queue, uint64_t round) {
+        int64_t sum = 0;
+
+        for (int left = Fill(queue, round); left > 0; left--)
+            sum += queue.pop_front().result;
+
+        return sum;
+    }
+
+    // push_back until full, then pull the second entry until one is left, as issue pulls from mid-queue
+    template<typename Queue>
+    int64_t Pull(Queue& queue, uint64_t round) {
+        int64_t sum = 0;
+
+        for (int left = Fill(queue, round); left > 0; left--)
+            sum += queue.pull(std::next(queue.begin(), left > 1 ? 1 : 0)).result;
+
+        return sum;
+    }
+
+    // num_empty and is_full on a half-full queue, as fetch, issue and the stage skipping ask them
+    template<typename Queue>
+    int64_t Queries(Queue& queue, uint64_t round) {
+        if (round == 0) {
+            const std::size_t empty = queue.num_empty();
+
+            for (int i = 0; queue.num_empty() > empty / 2; i++)
+                queue.push_back(Entry{ Instruction(), i });
+        }
+
+        return static_cast<int64_t>(queue.num_empty()) + queue.is_full();
+    }
+
+    template<typename Queue>
+    double Time(int64_t (*test)(Queue&, uint64_t), uint64_t rounds, unsigned runs, unsigned opsPerRound) {
+        double best = 1e300;
+        int64_t checksum = 0;
+
+        for (unsigned run = 0; run < runs; run++) {
+            Queue queue;
+            const auto start = std::chrono::steady_clock::now();
+
+            for (uint64_t round = 0; round < rounds; round++)
+                checksum += test(queue, round);
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        sink = checksum;
+        return best * 1e9 / static_cast<double>(rounds * opsPerRound);
+    }
+
+    template<int N>
+    void Compare(uint64_t rounds, unsigned runs) {
+        using Old = opt_array<Entry, N>;
+        using New = ring_buffer<Entry, N>;
+
+        // Fill and empty take N operations each; the query test is two
+        const auto row = [&](const char* name, double old, double current) {
+            printf("  %-28s %10.2f %12.2f %8.2fx\n", name, old, current, old / current);
+        };
+
+        printf("Capacity %d          ns/op: opt_array  ring_buffer  speedup\n", N);
+        row("push_back", Time<Old>(PushBack<Old>, rounds, runs, N), Time<New>(PushBack<New>, rounds, runs, N));
+        row("push_back + pop_front", Time<Old>(PopFront<Old>, rounds, runs, 2 * N), Time<New>(PopFront<New>, rounds, runs, 2 * N));
+        row("push_back + pull", Time<Old>(Pull<Old>, rounds, runs, 2 * N), Time<New>(Pull<New>, rounds, runs, 2 * N));
+        row("num_empty + is_full", Time<Old>(Queries<Old>, rounds, runs, 2), Time<New>(Queries<New>, rounds, runs, 2));
+    }
+}
+
+int main(int argc, const char** argv) {
+    uint64_t rounds = 5000000;
+    unsigned runs = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+            rounds = std::stoull(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = static_cast<unsigned>(std::stoul(argv[++i]));
+    }
+
+    // The default pre-issue depth, and the deepest ALU queue
+    Compare<4>(rounds, runs);
+    Compare<16>(rounds, runs);
+    return 0;
+}